@@ -93,6 +93,8 @@ uint8_t *block_hash(block_t const *block,
 int block_is_valid(block_t const *block, block_t const *prev_block);
 int hash_matches_difficulty(uint8_t const hash[SHA256_DIGEST_LENGTH],
 			    uint32_t difficulty);
+int hash_matches_target(uint8_t const hash[SHA256_DIGEST_LENGTH],
+			uint8_t const target[SHA256_DIGEST_LENGTH]);
 void block_mine(block_t *block);
 
 #endif /* BLOCKCHAIN_H */
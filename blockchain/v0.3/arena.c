@@ -0,0 +1,116 @@
+#include "blockchain.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * arena_round - Rounds a size up to the alignment of arena allocations
+ * @size: Size to round
+ *
+ * Return: @size rounded up to a multiple of ARENA_ALIGN
+ */
+size_t arena_round(size_t size)
+{
+	return ((size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1));
+}
+
+/**
+ * arena_chunk - Allocates a chunk able to hold a number of bytes
+ * @size: Size wanted for the chunk, its header included
+ * @need: Number of bytes the chunk must be able to hand out
+ *
+ * Return: Pointer to the chunk, or NULL on failure
+ */
+static arena_chunk_t *arena_chunk(size_t size, size_t need)
+{
+	arena_chunk_t *chunk;
+	size_t header = arena_round(sizeof(*chunk));
+
+	if (size < ARENA_CHUNK_MIN)
+		size = ARENA_CHUNK_MIN;
+	if (size < header + need)
+		size = header + need;
+	chunk = malloc(size);
+	if (!chunk)
+		return (NULL);
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = header;
+	return (chunk);
+}
+
+/**
+ * arena_create - Creates an arena
+ * @hint: Number of bytes expected to be allocated, each allocation
+ *        rounded with arena_round, sizes the first chunk
+ *
+ * Description: The arena lives in its first chunk, creating it takes a
+ * single malloc. Allocations past @hint chain more chunks.
+ *
+ * Return: Pointer to the arena, or NULL on failure
+ */
+arena_t *arena_create(size_t hint)
+{
+	arena_chunk_t *chunk;
+	arena_t *arena;
+	size_t self = arena_round(sizeof(*arena));
+	size_t header = arena_round(sizeof(*chunk));
+
+	chunk = arena_chunk(header + self + arena_round(hint), self);
+	if (!chunk)
+		return (NULL);
+	arena = (arena_t *)((uint8_t *)chunk + chunk->used);
+	chunk->used += self;
+	arena->chunk = chunk;
+	arena->total = chunk->size;
+	return (arena);
+}
+
+/**
+ * arena_alloc - Allocates zeroed memory from an arena
+ * @arena: Arena
+ * @size: Number of bytes
+ *
+ * Description: When the current chunk is full, a new one twice its size,
+ * up to ARENA_CHUNK_MAX, is chained in front of it. The memory is only
+ * released by arena_destroy.
+ *
+ * Return: Pointer to memory aligned on ARENA_ALIGN, or NULL on failure
+ */
+void *arena_alloc(arena_t *arena, size_t size)
+{
+	arena_chunk_t *chunk = arena->chunk, *grown;
+	uint8_t *p;
+
+	size = arena_round(size ? size : 1);
+	if (chunk->size - chunk->used < size)
+	{
+		grown = arena_chunk(chunk->size < ARENA_CHUNK_MAX / 2 ?
+				    2 * chunk->size : ARENA_CHUNK_MAX, size);
+		if (!grown)
+			return (NULL);
+		grown->next = chunk;
+		arena->chunk = chunk = grown;
+		arena->total += grown->size;
+	}
+	p = (uint8_t *)chunk + chunk->used;
+	chunk->used += size;
+	return (memset(p, 0, size));
+}
+
+/**
+ * arena_destroy - Frees an arena and everything allocated from it
+ * @arena: Arena, may be NULL
+ */
+void arena_destroy(arena_t *arena)
+{
+	arena_chunk_t *chunk, *next;
+
+	if (!arena)
+		return;
+	/* The arena itself is in the last chunk, freed last */
+	for (chunk = arena->chunk; chunk; chunk = next)
+	{
+		next = chunk->next;
+		free(chunk);
+	}
+}
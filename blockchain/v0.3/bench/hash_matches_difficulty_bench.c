@@ -0,0 +1,133 @@
+#include "blockchain.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_HASHES 4096 /* Hashes checked in turn, a power of 2 */
+#define BENCH_ROUNDS 20000 /* Passes over the hashes per difficulty */
+
+/**
+ * bit_loop - Reference check, the former hash_matches_difficulty
+ * @hash: The hash to check
+ * @difficulty: Number of leading zero bits required
+ *
+ * Return: 1 if difficulty is matched, 0 otherwise
+ */
+static int bit_loop(uint8_t const *hash, uint32_t difficulty)
+{
+	uint32_t bits_checked = 0, i;
+	uint8_t byte;
+	int bit;
+
+	for (i = 0; i < SHA256_DIGEST_LENGTH && bits_checked < difficulty; i++)
+	{
+		byte = hash[i];
+
+		for (bit = 7; bit >= 0 &&
+			bits_checked < difficulty; bit--, bits_checked++)
+		{
+			if ((byte >> bit) & 1)
+				return (0);
+		}
+	}
+
+	return (1);
+}
+
+/**
+ * fill - Fills hashes with random bytes after a number of zero bits
+ * @hashes: Hashes to fill
+ * @zeros: Number of leading zero bits, the bit after them is set
+ */
+static void fill(uint8_t (*hashes)[SHA256_DIGEST_LENGTH], uint32_t zeros)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < BENCH_HASHES; i++)
+	{
+		for (j = 0; j < SHA256_DIGEST_LENGTH; j++)
+			hashes[i][j] = (uint8_t)rand();
+		for (j = 0; j < zeros && j < SHA256_DIGEST_LENGTH * 8; j++)
+			hashes[i][j / 8] &= (uint8_t)~(0x80 >> (j % 8));
+		if (zeros < SHA256_DIGEST_LENGTH * 8)
+			hashes[i][zeros / 8] |= (uint8_t)(0x80 >> (zeros % 8));
+	}
+}
+
+/**
+ * check_all - Compares hash_matches_difficulty to the bit loop
+ * @hashes: Scratch hashes
+ *
+ * Return: Number of mismatches
+ */
+static unsigned int check_all(uint8_t (*hashes)[SHA256_DIGEST_LENGTH])
+{
+	unsigned int bad = 0;
+	uint32_t zeros, difficulty, i;
+
+	for (zeros = 0; zeros <= 259; zeros++)
+	{
+		fill(hashes, zeros);
+		for (difficulty = 0; difficulty <= 300; difficulty++)
+		{
+			for (i = 0; i < 4; i++)
+				bad += hash_matches_difficulty(hashes[i], difficulty) !=
+					bit_loop(hashes[i], difficulty);
+		}
+	}
+	return (bad);
+}
+
+/**
+ * rate - Measures checks per second on hashes that pass
+ * @hashes: Scratch hashes
+ * @difficulty: Difficulty to check
+ * @check: Function to measure
+ *
+ * Return: Millions of checks per second
+ */
+static double rate(uint8_t (*hashes)[SHA256_DIGEST_LENGTH],
+	uint32_t difficulty, int (*check)(uint8_t const *, uint32_t))
+{
+	struct timespec start, end;
+	unsigned long passed = 0;
+	uint32_t r, i;
+	double sec;
+
+	fill(hashes, difficulty);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (r = 0; r < BENCH_ROUNDS; r++)
+	{
+		for (i = 0; i < BENCH_HASHES; i++)
+			passed += (unsigned long)check(hashes[i], difficulty);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	sec = (double)(end.tv_sec - start.tv_sec) +
+		(double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	if (passed != (unsigned long)BENCH_ROUNDS * BENCH_HASHES)
+		fprintf(stderr, "difficulty %u: unexpected failures\n", difficulty);
+	return ((double)passed / sec / 1e6);
+}
+
+/**
+ * main - Checks hash_matches_difficulty against a bit loop, then measures
+ * both
+ *
+ * Return: 0 on success, 1 on a mismatch
+ */
+int main(void)
+{
+	static uint8_t hashes[BENCH_HASHES][SHA256_DIGEST_LENGTH];
+	unsigned int bad;
+	uint32_t difficulty;
+
+	srand(1);
+	bad = check_all(hashes);
+	printf("mismatches: %u\n", bad);
+	printf("difficulty   bit loop   hash_matches_difficulty\n");
+	for (difficulty = 0; difficulty <= 64; difficulty += 8)
+		printf("%10u %8.1f M/s %8.1f M/s\n", difficulty,
+		       rate(hashes, difficulty, bit_loop),
+		       rate(hashes, difficulty, hash_matches_difficulty));
+	return (bad != 0);
+}
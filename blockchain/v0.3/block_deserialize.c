@@ -0,0 +1,212 @@
+#include "blockchain.h"
+#include "transaction.h"
+#include <string.h>
+
+/**
+ * map_cursor_take - Consumes bytes of a mapped file
+ * @cur: Cursor
+ * @size: Number of bytes to consume
+ *
+ * Return: Pointer to the consumed bytes, or NULL if fewer are left
+ */
+uint8_t *map_cursor_take(map_cursor_t *cur, size_t size)
+{
+	uint8_t *p = cur->pos;
+
+	if (size > cur->left)
+		return (NULL);
+	cur->pos += size;
+	cur->left -= size;
+	return (p);
+}
+
+/**
+ * read_transaction - reads a transaction from a mapped file
+ * @cur: Cursor in the mapping
+ * @views: Whether the inputs may be views into the mapping
+ * @arena: Arena of the block, holding the transaction
+ *
+ * Description: tx_in_t has no alignment requirement, so inputs can be
+ * views into the mapping. The outputs are copied, tx_out_t needs a 4-byte
+ * alignment the file does not guarantee. An output whose key is not in
+ * compressed form is rejected, only TX_PUB_LEN bytes of it are stored.
+ *
+ * Return: pointer to newly created transaction or NULL on failure
+ */
+static transaction_t *read_transaction(map_cursor_t *cur, int views,
+	arena_t *arena)
+{
+	transaction_t *tx;
+	uint8_t *p;
+	int i, nb_inputs, nb_outputs;
+
+	tx = arena_alloc(arena, sizeof(*tx));
+	if (!tx)
+		return (NULL);
+	tx->inputs_mapped = views;
+	tx->in_arena = 1;
+
+	p = map_cursor_take(cur, sizeof(tx->id) + sizeof(int));
+	if (!p)
+		goto fail;
+	memcpy(tx->id, p, sizeof(tx->id));
+	nb_inputs = (int)hblk_load32(p + sizeof(tx->id), cur->swap);
+
+	tx->inputs = llist_create(MT_SUPPORT_FALSE);
+	if (!tx->inputs || nb_inputs < 0)
+		goto fail;
+
+	for (i = 0; i < nb_inputs; i++)
+	{
+		tx_in_t *in;
+
+		p = map_cursor_take(cur, sizeof(*in));
+		in = p && !views ? arena_alloc(arena, sizeof(*in))
+			: (tx_in_t *)p;
+		if (!in)
+			goto fail;
+		if (!views)
+			memcpy(in, p, sizeof(*in));
+		if (llist_add_node(tx->inputs, in, ADD_NODE_REAR) == -1)
+			goto fail;
+	}
+
+	p = map_cursor_take(cur, sizeof(int));
+	if (!p)
+		goto fail;
+	nb_outputs = (int)hblk_load32(p, cur->swap);
+
+	tx->outputs = llist_create(MT_SUPPORT_FALSE);
+	if (!tx->outputs || nb_outputs < 0)
+		goto fail;
+
+	for (i = 0; i < nb_outputs; i++)
+	{
+		tx_out_t *out;
+
+		p = map_cursor_take(cur, sizeof(*out));
+		out = p ? arena_alloc(arena, sizeof(*out)) : NULL;
+		if (!out)
+			goto fail;
+		memcpy(out, p, sizeof(*out));
+		if (cur->swap)
+			out->amount = __builtin_bswap32(out->amount);
+		if (ec_pub_len(out->pub) != TX_PUB_LEN)
+			goto fail;
+		if (llist_add_node(tx->outputs, out, ADD_NODE_REAR) == -1)
+			goto fail;
+	}
+
+	return (tx);
+fail:
+	transaction_destroy(tx);
+	return (NULL);
+}
+
+/**
+ * block_arena_size - Measures the memory a block takes in its arena
+ * @cur: Cursor on the transactions of the block, copied
+ * @nb_tx: Number of transactions of the block
+ * @views: Whether the inputs will be views into the mapping
+ *
+ * Description: Only the counts of inputs and outputs are read. A
+ * truncated block is measured up to where it ends, read_transaction
+ * reports it.
+ *
+ * Return: Number of bytes to allocate, the block itself included
+ */
+static size_t block_arena_size(map_cursor_t cur, int nb_tx, int views)
+{
+	size_t size = arena_round(sizeof(block_t));
+	uint8_t *p;
+	int nb;
+
+	while (nb_tx-- > 0)
+	{
+		p = map_cursor_take(&cur, SHA256_DIGEST_LENGTH + sizeof(int));
+		if (!p)
+			break;
+		nb = (int)hblk_load32(p + SHA256_DIGEST_LENGTH, cur.swap);
+		if (nb < 0 ||
+		    !map_cursor_take(&cur, (size_t)nb * sizeof(tx_in_t)))
+			break;
+		size += arena_round(sizeof(transaction_t));
+		if (!views)
+			size += (size_t)nb * arena_round(sizeof(tx_in_t));
+		p = map_cursor_take(&cur, sizeof(int));
+		if (!p)
+			break;
+		nb = (int)hblk_load32(p, cur.swap);
+		if (nb < 0 ||
+		    !map_cursor_take(&cur, (size_t)nb * sizeof(tx_out_t)))
+			break;
+		size += (size_t)nb * arena_round(sizeof(tx_out_t));
+	}
+	return (size);
+}
+
+/**
+ * block_deserialize - reads a single block from a mapped file
+ * @cur: Cursor in the mapping, moved past the block
+ * @views: Whether the inputs of the transactions may be views into the
+ *         mapping, in which case the mapping must outlive the block
+ *
+ * Description: Reads the layout written by block_serialize. The block and
+ * its transactions are allocated from a single chunk of an arena, see
+ * block_destroy.
+ *
+ * Return: pointer to newly created block or NULL
+ */
+block_t *block_deserialize(map_cursor_t *cur, int views)
+{
+	block_t *block;
+	arena_t *arena;
+	uint32_t data_len;
+	uint8_t *info, *p;
+	int i, nb_tx;
+
+	info = map_cursor_take(cur, sizeof(block_info_t) + sizeof(uint32_t));
+	if (!info)
+		return (NULL);
+	data_len = hblk_load32(info + sizeof(block_info_t), cur->swap);
+	if (data_len > BLOCKCHAIN_DATA_MAX)
+		return (NULL);
+	p = map_cursor_take(cur, data_len + SHA256_DIGEST_LENGTH + sizeof(int));
+	if (!p)
+		return (NULL);
+	nb_tx = (int)hblk_load32(p + data_len + SHA256_DIGEST_LENGTH, cur->swap);
+	if (nb_tx < 0)
+		return (NULL);
+
+	arena = arena_create(block_arena_size(*cur, nb_tx, views));
+	block = arena ? arena_alloc(arena, sizeof(*block)) : NULL;
+	if (!block)
+		return (arena_destroy(arena), NULL);
+	block->arena = arena;
+
+	memcpy(&block->info, info, sizeof(block_info_t));
+	if (cur->swap)
+		block_info_bswap(&block->info);
+	block->data.len = data_len;
+	memcpy(block->data.buffer, p, data_len);
+	memcpy(block->hash, p + data_len, SHA256_DIGEST_LENGTH);
+
+	block->transactions = llist_create(MT_SUPPORT_FALSE);
+	if (!block->transactions)
+		goto fail;
+
+	for (i = 0; i < nb_tx; i++)
+	{
+		transaction_t *tx = read_transaction(cur, views, arena);
+		if (!tx || llist_add_node(block->transactions, tx, ADD_NODE_REAR) == -1)
+		{
+			transaction_destroy(tx);
+			goto fail;
+		}
+	}
+
+	return (block);
+fail:
+	block_destroy(block);
+	return (NULL);
+}
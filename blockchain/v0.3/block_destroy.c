@@ -6,15 +6,26 @@
  * block_destroy - Frees all memory associated with a block,
  *                 including its transactions list
  * @block: Pointer to the block to destroy
+ *
+ * Description: A block with an arena lives in it, along with the
+ * transactions deserialized with it. They are released at once with the
+ * arena, only the list nodes and the transactions added later are freed
+ * one by one.
  */
 void block_destroy(block_t *block)
 {
+    arena_t *arena;
+
     if (!block)
         return;
 
     /* Destroy the transactions list and free each transaction */
+    arena = block->arena;
     if (block->transactions)
         llist_destroy(block->transactions, 1, (void (*)(void *))transaction_destroy);
 
-    free(block);
+    if (arena)
+        arena_destroy(arena);
+    else
+        free(block);
 }
@@ -5,43 +5,61 @@
 #include <string.h>
 
 /**
- * block_hash - Computes the hash of a block including its transactions
+ * block_hash - Computes the hash of a block header
  * @block: Pointer to the block to hash
  * @hash_buf: Buffer where the hash will be stored (SHA256_DIGEST_LENGTH)
  *
+ * Description: Transactions are committed through info.merkle_root, so the
+ * cost of hashing does not depend on the number of transactions.
+ *
  * Return: Pointer to hash_buf on success, or NULL on failure
  */
 uint8_t *block_hash(block_t const *block,
 	uint8_t hash_buf[SHA256_DIGEST_LENGTH])
 {
-	SHA256_CTX ctx;
-	int i, tx_count;
-	transaction_t *tx;
+	sha256_ctx_t ctx;
 
 	if (!block || !hash_buf)
 		return (NULL);
 
-	SHA256_Init(&ctx);
+	sha256_init(&ctx);
 
-	/* Hash block info */
-	SHA256_Update(&ctx, &block->info, sizeof(block_info_t));
+	/* Hash block info, Merkle root included */
+	sha256_update(&ctx, &block->info, sizeof(block_info_t));
 
 	/* Hash block data (only the used length) */
-	SHA256_Update(&ctx, &block->data.len, sizeof(uint32_t));
-	SHA256_Update(&ctx, block->data.buffer, block->data.len);
-
-	/* Hash all transaction IDs */
-	tx_count = llist_size(block->transactions);
-	for (i = 0; i < tx_count; i++)
-	{
-		tx = llist_get_node_at(block->transactions, i);
-		if (!tx)
-			continue;
-
-		/* Each tx already has a computed hash ID */
-		SHA256_Update(&ctx, tx->id, SHA256_DIGEST_LENGTH);
-	}
-
-	SHA256_Final(hash_buf, &ctx);
+	sha256_update(&ctx, &block->data.len, sizeof(uint32_t));
+	sha256_update(&ctx, block->data.buffer, block->data.len);
+
+	sha256_final(&ctx, hash_buf);
 	return (hash_buf);
 }
+
+/**
+ * block_hash_preimage - Serializes the bytes block_hash feeds to SHA-256
+ * @block: Pointer to the block
+ * @len: Receives the length of the returned buffer
+ *
+ * Description: Lets batch hashers (e.g. mining) lay out many candidate
+ * headers once and only patch the nonce, at offsetof(block_info_t, nonce).
+ *
+ * Return: Newly allocated buffer, or NULL on failure
+ */
+uint8_t *block_hash_preimage(block_t const *block, size_t *len)
+{
+	uint8_t *buf;
+
+	if (!block || !len)
+		return (NULL);
+
+	*len = sizeof(block_info_t) + sizeof(uint32_t) + block->data.len;
+	buf = malloc(*len);
+	if (!buf)
+		return (NULL);
+
+	memcpy(buf, &block->info, sizeof(block_info_t));
+	memcpy(buf + sizeof(block_info_t), &block->data.len, sizeof(uint32_t));
+	memcpy(buf + sizeof(block_info_t) + sizeof(uint32_t), block->data.buffer,
+	       block->data.len);
+	return (buf);
+}
@@ -3,27 +3,88 @@
 #include <string.h>
 
 /**
- * block_is_valid - Validates a block against its previous block
+ * struct block_checks_s - Signature checks gathered from a block
+ *
+ * @all_unspent: Set of all unspent outputs
+ * @checks:      Checks of all the inputs of the block, coinbase aside
+ * @count:       Number of checks gathered so far
+ * @failed:      Set when a transaction fails its other checks
+ */
+typedef struct block_checks_s
+{
+	utxo_set_t *all_unspent;
+	sig_check_t *checks;
+	size_t count;
+	int failed;
+} block_checks_t;
+
+/**
+ * count_inputs - Counts the inputs of the transactions of a block
+ * @node: Pointer to the transaction_t
+ * @idx: Index of the transaction
+ * @arg: Pointer to the size_t count
+ *
+ * Return: Always 0
+ */
+static int count_inputs(llist_node_t node, unsigned int idx, void *arg)
+{
+	transaction_t const *tx = node;
+	int nb = tx ? llist_size(tx->inputs) : 0;
+
+	if (idx && nb > 0)
+		*(size_t *)arg += (size_t)nb;
+	return (0);
+}
+
+/**
+ * gather_checks - Checks a transaction of a block, signatures aside, and
+ * gathers its signature checks
+ * @node: Pointer to the transaction_t
+ * @idx: Index of the transaction, the coinbase is skipped
+ * @arg: Pointer to the block_checks_t
+ *
+ * Return: 0 to keep iterating, 1 to stop on failure
+ */
+static int gather_checks(llist_node_t node, unsigned int idx, void *arg)
+{
+	transaction_t const *tx = node;
+	block_checks_t *gather = arg;
+	int nb_checks;
+
+	if (!idx)
+		return (0);
+	nb_checks = transaction_check_inputs(tx, gather->all_unspent,
+					     gather->checks + gather->count);
+	if (nb_checks < 0)
+		return (gather->failed = 1);
+	gather->count += (size_t)nb_checks;
+	return (0);
+}
+
+/**
+ * block_is_valid_mt - Validates a block against its previous block,
+ * verifying the signatures of its transactions on several threads
  * @block: Pointer to the block to validate
  * @prev_block: Pointer to the previous block in the blockchain
- * @all_unspent: List of all unspent transaction outputs
+ * @all_unspent: Set of all unspent transaction outputs
+ * @nb_threads: Number of threads verifying signatures, 0 to use every
+ *              online CPU
  *
- * Return: 0 if valid, or error code:
- *   1 - block or prev_block is NULL when needed
- *   2 - index is not prev_block index + 1
- *   4 - previous hash does not match
- *   5 - block hash mismatch
- *   6 - hash does not match difficulty
- *   7 - invalid transaction list (missing or empty)
- *   8 - first transaction is not valid coinbase
- *   9 - a regular transaction is invalid
+ * Description: Everything but the signatures is checked first, in block
+ * order. The signatures of all the inputs of the block are then verified
+ * together, see sig_checks_run. The error codes are those of
+ * block_is_valid and do not depend on @nb_threads.
+ *
+ * Return: 0 if valid, or the error code of block_is_valid
  */
-int block_is_valid(block_t const *block, block_t const *prev_block,
-		   llist_t *all_unspent)
+int block_is_valid_mt(block_t const *block, block_t const *prev_block,
+		      utxo_set_t *all_unspent, unsigned int nb_threads)
 {
 	uint8_t hash_buf[SHA256_DIGEST_LENGTH];
-	transaction_t *tx;
-	int i, tx_count;
+	uint8_t root[SHA256_DIGEST_LENGTH];
+	block_checks_t gather;
+	size_t nb_inputs = 0;
+	int tx_count;
 
 	if (!block)
 		return (1);
@@ -34,8 +95,7 @@ int block_is_valid(block_t const *block, block_t const *prev_block,
 			return (1);
 		if (block->info.index != prev_block->info.index + 1)
 			return (2);
-		if (!block->info.prev_hash ||
-		    memcmp(block->info.prev_hash, prev_block->hash,
+		if (memcmp(block->info.prev_hash, prev_block->hash,
 			   SHA256_DIGEST_LENGTH) != 0)
 			return (4);
 	}
@@ -54,17 +114,49 @@ int block_is_valid(block_t const *block, block_t const *prev_block,
 	if (tx_count < 1)
 		return (7);
 
-	tx = llist_get_node_at(block->transactions, 0);
-	if (!coinbase_is_valid(tx, block->info.index))
+	if (!merkle_root(block->transactions, root) ||
+	    memcmp(root, block->info.merkle_root, SHA256_DIGEST_LENGTH) != 0)
+		return (10);
+
+	if (!coinbase_is_valid(llist_get_head(block->transactions),
+			       block->info.index))
 		return (8);
 
-	/* Validate remaining transactions */
-	for (i = 1; i < tx_count; i++)
-	{
-		tx = llist_get_node_at(block->transactions, i);
-		if (!transaction_is_valid(tx, all_unspent))
-			return (9);
-	}
+	/* Validate remaining transactions, then all their signatures */
+	llist_for_each(block->transactions, count_inputs, &nb_inputs);
+	memset(&gather, 0, sizeof(gather));
+	gather.all_unspent = all_unspent;
+	gather.checks = malloc((nb_inputs ? nb_inputs : 1) * sizeof(sig_check_t));
+	if (!gather.checks)
+		return (9);
+	llist_for_each(block->transactions, gather_checks, &gather);
+	if (gather.failed ||
+	    sig_checks_run(gather.checks, gather.count, nb_threads) != -1)
+		return (free(gather.checks), 9);
 
+	free(gather.checks);
 	return (0);
 }
+
+/**
+ * block_is_valid - Validates a block against its previous block
+ * @block: Pointer to the block to validate
+ * @prev_block: Pointer to the previous block in the blockchain
+ * @all_unspent: Set of all unspent transaction outputs
+ *
+ * Return: 0 if valid, or error code:
+ *   1 - block or prev_block is NULL when needed
+ *   2 - index is not prev_block index + 1
+ *   4 - previous hash does not match
+ *   5 - block hash mismatch
+ *   6 - hash does not match difficulty
+ *   7 - invalid transaction list (missing or empty)
+ *   8 - first transaction is not valid coinbase
+ *   9 - a regular transaction is invalid
+ *  10 - Merkle root does not match the transactions
+ */
+int block_is_valid(block_t const *block, block_t const *prev_block,
+		   utxo_set_t *all_unspent)
+{
+	return (block_is_valid_mt(block, prev_block, all_unspent, 1));
+}
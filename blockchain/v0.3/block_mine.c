@@ -1,24 +1,225 @@
 #include "blockchain.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
 
 /**
- * block_mine - Mines a block by finding a valid hash
+ * struct mine_ctx_s - State shared by the mining workers
+ *
+ * @block:  Block being mined (read-only while workers run)
+ * @stride: Number of workers, worker i tries nonces i + 1, i + 1 + stride...
+ * @found:  Set once a worker found a valid nonce, cancels the others
+ * @nonce:  Winning nonce
+ * @hash:   Hash of the block with the winning nonce
+ * @lock:   Held while the workers are started, serializes the write-back
+ *          of the winner
+ */
+typedef struct mine_ctx_s
+{
+	block_t const *block;
+	uint64_t stride;
+	int found;
+	uint64_t nonce;
+	uint8_t hash[SHA256_DIGEST_LENGTH];
+	pthread_mutex_t lock;
+} mine_ctx_t;
+
+/**
+ * struct mine_worker_s - Per-thread mining arguments
+ *
+ * @ctx:   Shared mining state
+ * @first: First nonce tried by this worker
+ */
+typedef struct mine_worker_s
+{
+	mine_ctx_t *ctx;
+	uint64_t first;
+} mine_worker_t;
+
+/**
+ * mine_report - Records a winning nonce unless another worker was first
+ * @ctx: Shared mining state
+ * @nonce: Nonce that produced @hash
+ * @hash: Hash matching the difficulty
+ */
+static void mine_report(mine_ctx_t *ctx, uint64_t nonce,
+	uint8_t const hash[SHA256_DIGEST_LENGTH])
+{
+	pthread_mutex_lock(&ctx->lock);
+	if (!ctx->found)
+	{
+		ctx->nonce = nonce;
+		memcpy(ctx->hash, hash, SHA256_DIGEST_LENGTH);
+		__atomic_store_n(&ctx->found, 1, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&ctx->lock);
+}
+
+/**
+ * mine_batch - Walks a residue class of the nonce space with the SHA-256
+ * template kernel
+ * @worker: Worker arguments
+ * @pre: Hash preimage of the block, see block_hash_preimage
+ * @len: Length of @pre
+ *
+ * Description: Only the nonce changes between attempts, so everything
+ * that precedes it in the preimage, and the schedules of the blocks that
+ * follow it, are computed once. Candidates are rejected on the first
+ * digest word, hash_matches_difficulty only sees the survivors. Batches
+ * are checked in nonce order so that a single worker still finds the
+ * smallest matching nonce.
+ *
+ * Return: 1 when done, 0 if the template could not be set up
+ */
+static int mine_batch(mine_worker_t *worker, uint8_t const *pre, size_t len)
+{
+	mine_ctx_t *ctx = worker->ctx;
+	uint8_t digests[SHA256_BATCH_MAX][SHA256_DIGEST_LENGTH];
+	uint64_t patches[SHA256_BATCH_MAX], nonce = worker->first;
+	uint32_t difficulty = ctx->block->info.difficulty, mask;
+	unsigned int lanes, l;
+	sha256_tmpl_t tmpl;
+
+	if (!sha256_tmpl_init(&tmpl, pre, len, offsetof(block_info_t, nonce)))
+		return (0);
+	lanes = sha256_tmpl_lanes(&tmpl);
+	while (!__atomic_load_n(&ctx->found, __ATOMIC_RELAXED))
+	{
+		for (l = 0; l < lanes; l++)
+			patches[l] = nonce + l * ctx->stride;
+		mask = sha256_tmpl_try_batch(&tmpl, patches, lanes, difficulty,
+					     digests);
+		for (l = 0; mask && l < lanes; l++)
+			if ((mask & (1U << l)) &&
+			    hash_matches_difficulty(digests[l], difficulty))
+			{
+				mine_report(ctx, patches[l], digests[l]);
+				sha256_tmpl_destroy(&tmpl);
+				return (1);
+			}
+		nonce += lanes * ctx->stride;
+	}
+	sha256_tmpl_destroy(&tmpl);
+	return (1);
+}
+
+/**
+ * mine_worker - Walks one residue class of the nonce space
+ * @arg: Pointer to the worker's mine_worker_t
+ *
+ * Description: The worker first waits for @lock, held until every worker
+ * is started and its residue class known. Each worker hashes its own copy
+ * of the block so that no state is shared in the hot loop besides the
+ * cancellation flag. Hashing goes through the template kernel, falling
+ * back to one block_hash per nonce when memory is short.
+ *
+ * Return: NULL
+ */
+static void *mine_worker(void *arg)
+{
+	mine_worker_t *worker = arg;
+	mine_ctx_t *ctx = worker->ctx;
+	uint8_t *pre;
+	size_t len;
+	block_t local;
+
+	pthread_mutex_lock(&ctx->lock);
+	pthread_mutex_unlock(&ctx->lock);
+	pre = block_hash_preimage(ctx->block, &len);
+	if (pre && mine_batch(worker, pre, len))
+	{
+		free(pre);
+		return (NULL);
+	}
+	free(pre);
+	memcpy(&local, ctx->block, sizeof(local));
+	local.info.nonce = worker->first;
+	while (!__atomic_load_n(&ctx->found, __ATOMIC_RELAXED))
+	{
+		block_hash(&local, local.hash);
+		if (hash_matches_difficulty(local.hash, local.info.difficulty))
+		{
+			mine_report(ctx, local.info.nonce, local.hash);
+			break;
+		}
+		local.info.nonce += ctx->stride;
+	}
+	return (NULL);
+}
+
+/**
+ * block_mine_mt - Mines a block using several threads
  * @block: Pointer to the block to be mined
+ * @nb_threads: Number of worker threads, 0 to use every online CPU
  *
- * Description: Increment nonce until a hash matches the difficulty.
+ * Description: The Merkle root of the block's transactions is committed
+ * into its header first. The nonce space is partitioned in residue classes,
+ * one per worker. The first worker to find a hash matching the difficulty
+ * cancels the others and its nonce and hash are written back into @block.
+ * With a single thread the nonces are tried in the same order as
+ * block_mine always did, starting at 1. The classes are handed out once
+ * the threads are started, among those that did and the calling thread,
+ * so threads failing to start shrink the pool but leave no nonce out.
+ * If the Merkle root cannot be computed, nothing is mined: the nonce and
+ * hash of @block are left unset, and callers must not trust them.
  */
-void block_mine(block_t *block)
+void block_mine_mt(block_t *block, unsigned int nb_threads)
 {
-	uint64_t ts;
+	mine_ctx_t ctx;
+	mine_worker_t *workers;
+	pthread_t *threads;
+	unsigned int i, started;
+	long nb_cpus;
 
-	if (!block)
+	if (!block || !merkle_root(block->transactions, block->info.merkle_root))
 		return;
+	if (!nb_threads)
+	{
+		nb_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nb_threads = nb_cpus > 0 ? (unsigned int)nb_cpus : 1;
+	}
+	workers = calloc(nb_threads, sizeof(*workers));
+	threads = calloc(nb_threads, sizeof(*threads));
+	if (!workers || !threads)
+	{
+		free(workers), free(threads);
+		workers = NULL, threads = NULL;
+		nb_threads = 1;
+	}
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.block = block;
+	pthread_mutex_init(&ctx.lock, NULL);
+	pthread_mutex_lock(&ctx.lock);
+	for (i = 1, started = 1; i < nb_threads; i++)
+	{
+		workers[started].ctx = &ctx;
+		if (pthread_create(&threads[started], NULL, mine_worker,
+				   &workers[started]) == 0)
+			started++;
+	}
+	ctx.stride = started;
+	for (i = 1; i < started; i++)
+		workers[i].first = i + 1;
+	pthread_mutex_unlock(&ctx.lock);
+	mine_worker(&(mine_worker_t){ &ctx, 1 });
+	for (i = 1; i < started; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&ctx.lock);
+	free(workers), free(threads);
+	block->info.nonce = ctx.nonce;
+	memcpy(block->hash, ctx.hash, SHA256_DIGEST_LENGTH);
+}
 
-	ts = block->info.timestamp; /* Save initial timestamp */
-	block->info.nonce = 0;
-
-	do {
-		block->info.nonce++;
-		block->info.timestamp = ts; /* Keep timestamp fixed during mining */
-		block_hash(block, block->hash);
-	} while (!hash_matches_difficulty(block->hash, block->info.difficulty));
+/**
+ * block_mine - Mines a block by finding a valid hash
+ * @block: Pointer to the block to be mined
+ *
+ * Description: Increment nonce until a hash matches the difficulty. As
+ * with block_mine_mt, @block is not mined if its Merkle root cannot be
+ * computed.
+ */
+void block_mine(block_t *block)
+{
+	block_mine_mt(block, 1);
 }
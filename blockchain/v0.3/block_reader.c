@@ -0,0 +1,60 @@
+#include "blockchain.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/**
+ * block_reader_open - Opens a blockchain file for streaming
+ * @path: Path to the file
+ * @flags: 0 to read whole blocks, BLOCK_READER_HEADERS to only read their
+ *         headers, data and hash, skipping the transactions
+ *
+ * Description: Memory use is bounded by the largest block, whatever the
+ * size of the file.
+ *
+ * Return: Pointer to the reader, or NULL on failure
+ */
+block_reader_t *block_reader_open(char const *path, int flags)
+{
+	uint8_t header[12];
+	block_reader_t *reader;
+	struct stat st;
+
+	if (!path)
+		return (NULL);
+	reader = calloc(1, sizeof(*reader));
+	if (!reader)
+		return (NULL);
+	reader->flags = flags;
+	reader->fd = open(path, O_RDONLY);
+	if (reader->fd < 0)
+		return (free(reader), NULL);
+	reader->cap = BLOCK_READER_BUF;
+	reader->buf = malloc(reader->cap);
+	if (!reader->buf || fstat(reader->fd, &st) == -1 ||
+	    read(reader->fd, header, sizeof(header)) != sizeof(header) ||
+	    memcmp(header, "HBLK" HBLK_VERSION, 7) != 0 || (header[7] != 1 && header[7] != 2))
+		return (block_reader_close(reader), NULL);
+	reader->swap = header[7] != _get_endianness();
+	reader->nb_blocks = hblk_load32(header + 8, reader->swap);
+	reader->file_left = (uint64_t)st.st_size - sizeof(header);
+	posix_fadvise(reader->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	return (reader);
+}
+
+/**
+ * block_reader_close - Closes a streaming reader
+ * @reader: Reader, the last block it yielded is released
+ */
+void block_reader_close(block_reader_t *reader)
+{
+	if (!reader)
+		return;
+	block_destroy(reader->block);
+	if (reader->fd >= 0)
+		close(reader->fd);
+	free(reader->buf);
+	free(reader);
+}
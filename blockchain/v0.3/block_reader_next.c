@@ -0,0 +1,167 @@
+#include "blockchain.h"
+#include "transaction.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * reader_peek - Makes bytes ahead of the read position available
+ * @r: Reader
+ * @off: Offset of the bytes from the read position
+ * @n: Number of bytes
+ *
+ * Description: Unconsumed bytes are moved to the front of the buffer,
+ * which grows when they do not fit.
+ *
+ * Return: Pointer to the bytes, or NULL if the file ends before them
+ */
+static uint8_t *reader_peek(block_reader_t *r, size_t off, size_t n)
+{
+	size_t need = off + n, cap;
+	uint8_t *buf;
+	ssize_t got;
+
+	if (r->len - r->pos >= need)
+		return (r->buf + r->pos + off);
+	memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+	r->len -= r->pos, r->pos = 0;
+	if (need > r->cap)
+	{
+		cap = need > 2 * r->cap ? need : 2 * r->cap;
+		buf = realloc(r->buf, cap);
+		if (!buf)
+			return (NULL);
+		r->buf = buf, r->cap = cap;
+	}
+	while (r->len < need)
+	{
+		got = read(r->fd, r->buf + r->len, r->cap - r->len);
+		if (got <= 0)
+			return (NULL);
+		r->len += (size_t)got, r->file_left -= (uint64_t)got;
+	}
+	return (r->buf + r->pos + off);
+}
+
+/**
+ * reader_pass - Moves past bytes of a block
+ * @r: Reader
+ * @off: Offset from the read position, the block being kept in the
+ *       buffer, or NULL to consume the bytes
+ * @n: Number of bytes
+ *
+ * Description: Consumed bytes that were not read yet are seeked over.
+ *
+ * Return: 1 on success, 0 if the file ends before the bytes
+ */
+static int reader_pass(block_reader_t *r, size_t *off, uint64_t n)
+{
+	size_t avail = r->len - r->pos;
+
+	if (off)
+	{
+		if (n > r->file_left + (avail - *off))
+			return (0);
+		*off += n;
+		return (reader_peek(r, *off, 0) != NULL);
+	}
+	if (n <= avail)
+		return (r->pos += n, 1);
+	n -= avail;
+	r->pos = r->len = 0;
+	if (n > r->file_left || lseek(r->fd, (off_t)n, SEEK_CUR) == (off_t)-1)
+		return (0);
+	r->file_left -= n;
+	return (1);
+}
+
+/**
+ * block_walk - Walks a block in the file, reading its header
+ * @r: Reader
+ * @keep: Whether to keep the whole block in the buffer, otherwise the
+ *        transactions are skipped and the block is consumed
+ * @len: Receives the length of the block when kept
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int block_walk(block_reader_t *r, int keep, size_t *len)
+{
+	block_t *b = &r->header;
+	size_t off = 0, *o = keep ? &off : NULL;
+	uint8_t *p;
+	int nb_tx, nb;
+
+	p = reader_peek(r, off, sizeof(b->info) + sizeof(uint32_t));
+	if (!p)
+		return (0);
+	memcpy(&b->info, p, sizeof(b->info));
+	if (r->swap)
+		block_info_bswap(&b->info);
+	b->data.len = hblk_load32(p + sizeof(b->info), r->swap);
+	if (b->data.len > BLOCKCHAIN_DATA_MAX ||
+	    !reader_pass(r, o, sizeof(b->info) + sizeof(uint32_t)))
+		return (0);
+	p = reader_peek(r, off, b->data.len + SHA256_DIGEST_LENGTH + sizeof(int));
+	if (!p)
+		return (0);
+	memcpy(b->data.buffer, p, b->data.len);
+	memcpy(b->hash, p + b->data.len, SHA256_DIGEST_LENGTH);
+	nb_tx = (int)hblk_load32(p + b->data.len + SHA256_DIGEST_LENGTH, r->swap);
+	if (nb_tx < 0 || !reader_pass(r, o, b->data.len + SHA256_DIGEST_LENGTH +
+				      sizeof(int)))
+		return (0);
+	while (nb_tx--)
+	{
+		p = reader_peek(r, off, SHA256_DIGEST_LENGTH + sizeof(int));
+		if (!p)
+			return (0);
+		nb = (int)hblk_load32(p + SHA256_DIGEST_LENGTH, r->swap);
+		if (nb < 0 || !reader_pass(r, o, SHA256_DIGEST_LENGTH + sizeof(int)) ||
+		    !reader_pass(r, o, (uint64_t)nb * sizeof(tx_in_t)))
+			return (0);
+		p = reader_peek(r, off, sizeof(int));
+		if (!p)
+			return (0);
+		nb = (int)hblk_load32(p, r->swap);
+		if (nb < 0 || !reader_pass(r, o, sizeof(int)) ||
+		    !reader_pass(r, o, (uint64_t)nb * sizeof(tx_out_t)))
+			return (0);
+	}
+	*len = off;
+	return (1);
+}
+
+/**
+ * block_reader_next - Reads the next block of a blockchain file
+ * @reader: Reader
+ *
+ * Description: The block belongs to the reader and is valid until the
+ * next call. Its inputs point into the read buffer. With
+ * BLOCK_READER_HEADERS, its transactions list is NULL.
+ *
+ * Return: Pointer to the block, or NULL at the end of the file or on
+ * failure, in which case @reader->failed is set
+ */
+block_t const *block_reader_next(block_reader_t *reader)
+{
+	map_cursor_t cur;
+	size_t len;
+
+	if (!reader || reader->failed || reader->next >= reader->nb_blocks)
+		return (NULL);
+	block_destroy(reader->block);
+	reader->block = NULL;
+	if (!block_walk(reader, !(reader->flags & BLOCK_READER_HEADERS), &len))
+		return (reader->failed = 1, NULL);
+	reader->next++;
+	if (reader->flags & BLOCK_READER_HEADERS)
+		return (&reader->header);
+	cur.pos = reader->buf + reader->pos;
+	cur.left = len;
+	cur.swap = reader->swap;
+	reader->block = block_deserialize(&cur, 1);
+	if (!reader->block || cur.left)
+		return (reader->failed = 1, NULL);
+	reader->pos += len;
+	return (reader->block);
+}
@@ -0,0 +1,94 @@
+#include "blockchain.h"
+#include "transaction.h"
+
+/**
+ * struct write_ctx_s - State shared by the list writers
+ *
+ * @w:    Buffered writer
+ * @size: Size of each node
+ */
+typedef struct write_ctx_s
+{
+	write_buf_t *w;
+	size_t size;
+} write_ctx_t;
+
+/**
+ * write_node - Writes a fixed-size list node
+ * @node: Node to write
+ * @idx: Index of the node, unused
+ * @arg: Pointer to the write_ctx_t
+ *
+ * Return: 0 to keep iterating, 1 to stop on failure
+ */
+static int write_node(llist_node_t node, unsigned int idx, void *arg)
+{
+	write_ctx_t *ctx = arg;
+
+	(void)idx;
+	if (!node)
+		ctx->w->failed = 1;
+	else
+		write_buf_put(ctx->w, node, ctx->size);
+	return (ctx->w->failed);
+}
+
+/**
+ * write_list - Writes the size of a list then each of its nodes
+ * @w: Buffered writer
+ * @list: List of fixed-size nodes
+ * @size: Size of each node
+ */
+static void write_list(write_buf_t *w, llist_t *list, size_t size)
+{
+	write_ctx_t ctx;
+	int nb = llist_size(list);
+
+	write_buf_put(w, &nb, sizeof(int));
+	ctx.w = w;
+	ctx.size = size;
+	llist_for_each(list, write_node, &ctx);
+}
+
+/**
+ * write_transaction - writes a transaction
+ * @node: pointer to transaction to write
+ * @idx: index of the transaction in its block, unused
+ * @arg: pointer to the write_buf_t
+ *
+ * Return: 0 to keep iterating, 1 to stop on failure
+ */
+static int write_transaction(llist_node_t node, unsigned int idx, void *arg)
+{
+	transaction_t const *transaction = node;
+	write_buf_t *w = arg;
+
+	(void)idx;
+	if (!transaction)
+		return (w->failed = 1);
+	write_buf_put(w, transaction->id, sizeof(transaction->id));
+	write_list(w, transaction->inputs, sizeof(tx_in_t));
+	write_list(w, transaction->outputs, sizeof(tx_out_t));
+	return (w->failed);
+}
+
+/**
+ * block_serialize - writes a single block and its transactions
+ * @w: Buffered writer
+ * @block: pointer to block
+ *
+ * Description: This is the layout of a block in a blockchain file and in
+ * the segment files of a block store. Failures are recorded in @w.
+ */
+void block_serialize(write_buf_t *w, block_t const *block)
+{
+	int nb_tx;
+
+	write_buf_put(w, &block->info, sizeof(block_info_t));
+	write_buf_put(w, &block->data.len, sizeof(uint32_t));
+	write_buf_put(w, block->data.buffer, block->data.len);
+	write_buf_put(w, block->hash, SHA256_DIGEST_LENGTH);
+	nb_tx = llist_size(block->transactions);
+	write_buf_put(w, &nb_tx, sizeof(int));
+	llist_for_each(block->transactions, write_transaction, w);
+}
@@ -0,0 +1,142 @@
+#include "blockchain.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+/**
+ * block_store_segment - Opens a segment file of a block store
+ * @store: Block store
+ * @file: Number of the segment file
+ * @flags: Flags of open(2)
+ *
+ * Return: File descriptor, or -1 on failure
+ */
+int block_store_segment(block_store_t const *store, uint32_t file, int flags)
+{
+	char path[PATH_MAX];
+
+	if (snprintf(path, sizeof(path), "%s/blk%05u.dat", store->dir, file) >=
+	    (int)sizeof(path))
+		return (-1);
+	return (open(path, flags, 0600));
+}
+
+/**
+ * block_store_open - Opens a block store, creating it if needed
+ * @dir: Directory of the store
+ *
+ * Return: Pointer to the store, or NULL on failure
+ */
+block_store_t *block_store_open(char const *dir)
+{
+	uint8_t header[BLOCK_STORE_HEADER] = "HBLI" BLOCK_STORE_VERSION;
+	char path[PATH_MAX];
+	block_store_t *store;
+	block_loc_t last;
+	struct stat st;
+
+	if (!dir || (mkdir(dir, 0700) == -1 && errno != EEXIST) ||
+	    snprintf(path, sizeof(path), "%s/blocks.idx", dir) >= (int)sizeof(path))
+		return (NULL);
+	store = calloc(1, sizeof(*store));
+	if (!store)
+		return (NULL);
+	store->dir = strdup(dir);
+	store->index_fd = open(path, O_RDWR | O_CREAT, 0600);
+	if (!store->dir || store->index_fd < 0 || fstat(store->index_fd, &st) == -1)
+		return (block_store_close(store), NULL);
+
+	header[7] = _get_endianness();
+	if (st.st_size == 0 &&
+	    (pwrite(store->index_fd, header, sizeof(header), 0) != sizeof(header) ||
+	     fdatasync(store->index_fd) == -1))
+		return (block_store_close(store), NULL);
+	if (pread(store->index_fd, header, sizeof(header), 0) != sizeof(header) ||
+	    memcmp(header, "HBLI" BLOCK_STORE_VERSION, 7) != 0 ||
+	    header[7] != _get_endianness())
+		return (block_store_close(store), NULL);
+	memcpy(&store->count, header + 8, sizeof(store->count));
+
+	if (store->count)
+	{
+		if (!block_store_locate(store, store->count - 1, &last))
+			return (block_store_close(store), NULL);
+		store->seg = last.file;
+		store->seg_len = last.offset + last.len;
+	}
+	return (store);
+}
+
+/**
+ * block_store_close - Closes a block store
+ * @store: Block store
+ */
+void block_store_close(block_store_t *store)
+{
+	if (!store)
+		return;
+	if (store->index_fd >= 0)
+		close(store->index_fd);
+	free(store->dir);
+	free(store);
+}
+
+/**
+ * block_store_locate - Looks up the location of a block in a block store
+ * @store: Block store
+ * @height: Height of the block
+ * @loc: Receives the location
+ *
+ * Return: 1 on success, 0 if @height is not stored or on failure
+ */
+int block_store_locate(block_store_t const *store, uint32_t height,
+	block_loc_t *loc)
+{
+	off_t off = BLOCK_STORE_HEADER + (off_t)height * sizeof(*loc);
+
+	if (!store || !loc || height >= store->count)
+		return (0);
+	return (pread(store->index_fd, loc, sizeof(*loc), off) ==
+		(ssize_t)sizeof(*loc));
+}
+
+/**
+ * block_store_read - Reads a block of a block store
+ * @store: Block store
+ * @height: Height of the block
+ *
+ * Description: The block is located through the index and read with a
+ * single pread. It owns all its memory.
+ *
+ * Return: Pointer to the block, or NULL on failure
+ */
+block_t *block_store_read(block_store_t const *store, uint32_t height)
+{
+	block_loc_t loc;
+	map_cursor_t cur;
+	block_t *block = NULL;
+	uint8_t *buf;
+	int fd;
+
+	if (!block_store_locate(store, height, &loc))
+		return (NULL);
+	fd = block_store_segment(store, loc.file, O_RDONLY);
+	if (fd < 0)
+		return (NULL);
+	buf = malloc(loc.len ? loc.len : 1);
+	if (buf && pread(fd, buf, loc.len, (off_t)loc.offset) == (ssize_t)loc.len)
+	{
+		cur.pos = buf;
+		cur.left = loc.len;
+		cur.swap = 0;
+		block = block_deserialize(&cur, 0);
+	}
+	free(buf);
+	close(fd);
+	return (block);
+}
@@ -0,0 +1,131 @@
+#include "blockchain.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/**
+ * segment_open - Opens the last segment file of a store for appending
+ * @store: Block store
+ *
+ * Description: Bytes past the last stored block, left by an append that
+ * did not complete, are dropped.
+ *
+ * Return: File descriptor, or -1 on failure
+ */
+static int segment_open(block_store_t const *store)
+{
+	int fd = block_store_segment(store, store->seg, O_WRONLY | O_CREAT);
+
+	if (fd < 0)
+		return (-1);
+	if (ftruncate(fd, (off_t)store->seg_len) == -1 ||
+	    lseek(fd, (off_t)store->seg_len, SEEK_SET) == -1)
+		return (close(fd), -1);
+	return (fd);
+}
+
+/**
+ * segment_close - Syncs and closes a segment file
+ * @w: Buffered writer to the segment file, flushed
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int segment_close(write_buf_t *w)
+{
+	int ok = write_buf_flush(w) && fdatasync(w->fd) == 0;
+
+	return (close(w->fd) == 0 && ok);
+}
+
+/**
+ * block_store_publish - Appends index entries then publishes the new count
+ * @store: Block store
+ * @locs: Entries of the new blocks
+ * @nb: Number of new blocks
+ *
+ * Description: The count is a single aligned 4-byte write, issued once
+ * the entries are synced. It is synced in turn before returning.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int block_store_publish(block_store_t *store, block_loc_t const *locs,
+	uint32_t nb)
+{
+	uint32_t count = store->count + nb;
+	size_t len = nb * sizeof(*locs);
+
+	if (pwrite(store->index_fd, locs, len, BLOCK_STORE_HEADER +
+		   (off_t)store->count * sizeof(*locs)) != (ssize_t)len ||
+	    fdatasync(store->index_fd) == -1 ||
+	    pwrite(store->index_fd, &count, sizeof(count), 8) != sizeof(count) ||
+	    fdatasync(store->index_fd) == -1)
+		return (0);
+	store->count = count;
+	return (1);
+}
+
+/**
+ * block_store_append - Appends the blocks of a blockchain missing from a
+ * block store
+ * @store: Block store
+ * @blockchain: Blockchain, the store holds its first blocks
+ *
+ * Description: Only the blocks above the stored count are written, so
+ * saving one new block costs one block. A new segment file is started
+ * once the last one reaches BLOCK_STORE_SEGMENT_MAX.
+ *
+ * Return: Number of blocks appended, or -1 on failure
+ */
+int block_store_append(block_store_t *store, blockchain_t const *blockchain)
+{
+	uint32_t height, nb, i, old_seg;
+	uint64_t old_len, start;
+	block_loc_t *locs;
+	block_t *block;
+	write_buf_t w;
+	int ok;
+
+	if (!store || !blockchain)
+		return (-1);
+	height = blockchain_height(blockchain);
+	if (height < store->count)
+		return (-1);
+	nb = height - store->count;
+	if (!nb)
+		return (0);
+	locs = malloc(nb * sizeof(*locs));
+	if (!locs || !write_buf_init(&w, -1))
+		return (free(locs), -1);
+	old_seg = store->seg, old_len = store->seg_len;
+	w.fd = segment_open(store);
+	for (i = 0, ok = w.fd >= 0; ok && i < nb; i++)
+	{
+		if (store->seg_len >= BLOCK_STORE_SEGMENT_MAX)
+		{
+			ok = segment_close(&w);
+			store->seg++, store->seg_len = 0;
+			w.fd = ok ? segment_open(store) : -1;
+			if (w.fd < 0)
+				break;
+		}
+		block = blockchain_block_at(blockchain, store->count + i);
+		start = w.total;
+		if (block)
+			block_serialize(&w, block);
+		ok = block && !w.failed;
+		locs[i].file = store->seg;
+		locs[i].len = (uint32_t)(w.total - start);
+		locs[i].offset = store->seg_len;
+		store->seg_len += locs[i].len;
+	}
+	ok = w.fd >= 0 && segment_close(&w) && ok &&
+		block_store_publish(store, locs, nb);
+	write_buf_destroy(&w);
+	free(locs);
+	if (!ok)
+	{
+		store->seg = old_seg, store->seg_len = old_len;
+		return (-1);
+	}
+	return ((int)nb);
+}
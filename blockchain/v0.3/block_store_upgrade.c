@@ -0,0 +1,144 @@
+#include "blockchain.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/**
+ * store_read_index - Reads the index of a block store of version 0.3
+ * @dir: Directory of the store
+ * @count: Receives the number of blocks
+ *
+ * Return: Array of @count block locations, or NULL on failure
+ */
+static block_loc_t *store_read_index(char const *dir, uint32_t *count)
+{
+	uint8_t header[BLOCK_STORE_HEADER];
+	char path[PATH_MAX];
+	block_loc_t *locs = NULL;
+	size_t len;
+	int fd;
+
+	if (snprintf(path, sizeof(path), "%s/blocks.idx", dir) >=
+	    (int)sizeof(path))
+		return (NULL);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return (NULL);
+	if (pread(fd, header, sizeof(header), 0) == sizeof(header) &&
+	    !memcmp(header, "HBLI0.3", 7) && header[7] == _get_endianness())
+	{
+		memcpy(count, header + 8, sizeof(*count));
+		len = (size_t)*count * sizeof(*locs);
+		locs = malloc(len ? len : 1);
+		if (locs &&
+		    pread(fd, locs, len, BLOCK_STORE_HEADER) != (ssize_t)len)
+		{
+			free(locs);
+			locs = NULL;
+		}
+	}
+	close(fd);
+	return (locs);
+}
+
+/**
+ * store_upgrade_block - Converts a block of a block store of version 0.3
+ * @src: Store the block is read from
+ * @loc: Location of the block in @src
+ * @w: Buffered writer to the segment file of the new store
+ * @first: 1 for the Genesis Block, 0 otherwise
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int store_upgrade_block(block_store_t const *src,
+	block_loc_t const *loc, write_buf_t *w, int first)
+{
+	map_cursor_t cur;
+	uint8_t *buf;
+	int fd, ok;
+
+	fd = block_store_segment(src, loc->file, O_RDONLY);
+	if (fd < 0)
+		return (0);
+	buf = malloc(loc->len ? loc->len : 1);
+	ok = buf && pread(fd, buf, loc->len, (off_t)loc->offset) ==
+		(ssize_t)loc->len;
+	close(fd);
+	cur.pos = buf;
+	cur.left = loc->len;
+	cur.swap = 0;
+	ok = ok && blockchain_upgrade_block(&cur, w, first) && !cur.left;
+	free(buf);
+	return (ok);
+}
+
+/**
+ * segment_done - Syncs and closes a segment file of the new store
+ * @w: Buffered writer to the segment file, left without a descriptor
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int segment_done(write_buf_t *w)
+{
+	int ok = write_buf_flush(w) && fdatasync(w->fd) == 0;
+
+	ok = close(w->fd) == 0 && ok;
+	w->fd = -1;
+	return (ok);
+}
+
+/**
+ * block_store_upgrade - Converts a block store of version 0.3 to the
+ * current version
+ * @src: Directory of the 0.3 store
+ * @dst: Directory of the store to write, new or empty
+ *
+ * Description: Each block is converted as by blockchain_upgrade, into
+ * the segment file of the same number: blocks only shrink, so segments
+ * stay within BLOCK_STORE_SEGMENT_MAX. The index of @dst is published
+ * once every segment is synced, @dst holds no block on failure.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int block_store_upgrade(char const *src, char const *dst)
+{
+	block_store_t from, *to;
+	block_loc_t *locs, loc;
+	write_buf_t w;
+	uint64_t seg_start = 0, start;
+	uint32_t count = 0, i;
+	int ok = 1;
+
+	if (!src || !dst)
+		return (0);
+	from.dir = (char *)src;
+	locs = store_read_index(src, &count);
+	to = locs ? block_store_open(dst) : NULL;
+	if (!to || to->count || !write_buf_init(&w, -1))
+		return (free(locs), block_store_close(to), 0);
+	for (i = 0; ok && i < count; i++)
+	{
+		loc = locs[i];
+		if (!i || loc.file != locs[i - 1].file)
+		{
+			ok = w.fd < 0 || segment_done(&w);
+			w.fd = block_store_segment(to, loc.file, O_WRONLY |
+						   O_CREAT | O_TRUNC);
+			seg_start = w.total;
+			ok = ok && w.fd >= 0;
+		}
+		start = w.total;
+		ok = ok && store_upgrade_block(&from, &loc, &w, !i);
+		locs[i].offset = start - seg_start;
+		locs[i].len = (uint32_t)(w.total - start);
+	}
+	ok = (w.fd < 0 || segment_done(&w)) && ok;
+	write_buf_destroy(&w);
+	ok = ok && (!count || block_store_publish(to, locs, count));
+	free(locs);
+	block_store_close(to);
+	return (ok);
+}
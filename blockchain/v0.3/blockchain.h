@@ -14,7 +14,20 @@
 #define BLOCK_GENERATION_INTERVAL 1
 #define DIFFICULTY_ADJUSTMENT_INTERVAL 5
 #define EC_PUB_LEN 65
+#define HBLK_VERSION "0.4" /* Version of the chain file, after its magic */
 #define COINBASE_AMOUNT 50
+#define MERKLE_DEPTH_MAX 32
+#define WRITE_BUF_SIZE (4 << 20) /* Flushed by write_buf_put when full */
+#define BLOCK_STORE_SEGMENT_MAX (128 << 20) /* Segment size, one block over */
+#define BLOCK_STORE_HEADER 12 /* Magic, version, endianness, count */
+#define BLOCK_STORE_VERSION "0.4" /* Of the index and the segments */
+#define BLOCK_READER_BUF (1 << 20) /* Initial buffer, grows to the largest block */
+#define BLOCK_READER_HEADERS 1 /* block_reader_open flag, skip transactions */
+#define UTXO_SNAPSHOT_SUFFIX ".utxo" /* Appended to the path of a chain file */
+#define ARENA_CHUNK_MIN 2048 /* Smallest chunk of an arena */
+#define ARENA_CHUNK_MAX (1 << 20) /* Chunks double up to this size */
+#define ARENA_ALIGN 16 /* Alignment of arena allocations, a power of 2 */
+#define HBLK_V03_OUT 104 /* Size of an output in a 0.3 file, uncompressed key */
 
 
 /* === Structures === */
@@ -26,6 +39,7 @@ typedef struct block_info_s
 	uint64_t timestamp;
 	uint64_t nonce;
 	uint8_t prev_hash[SHA256_DIGEST_LENGTH];
+	uint8_t merkle_root[SHA256_DIGEST_LENGTH]; /* of the transaction IDs */
 } block_info_t;
 
 typedef struct block_data_s
@@ -34,18 +48,209 @@ typedef struct block_data_s
 	uint32_t len;
 } block_data_t;
 
+/**
+ * struct arena_chunk_s - Memory of an arena, allocated in one piece
+ *
+ * @next: Chunk filled before this one, or NULL
+ * @size: Size of the chunk, this header included
+ * @used: Number of bytes handed out, this header included
+ */
+typedef struct arena_chunk_s
+{
+	struct arena_chunk_s *next;
+	size_t size;
+	size_t used;
+} arena_chunk_t;
+
+/**
+ * struct arena_s - Bump allocator, everything is freed at once
+ *
+ * @chunk: Chunk being filled, the others are chained behind it
+ * @total: Number of bytes allocated in all chunks
+ */
+typedef struct arena_s
+{
+	arena_chunk_t *chunk;
+	size_t total;
+} arena_t;
+
 typedef struct block_s
 {
 	block_info_t info;
 	block_data_t data;
 	llist_t *transactions; /* list of transaction_t * */
 	uint8_t hash[SHA256_DIGEST_LENGTH];
+	arena_t *arena; /* Holds the block and its transactions, or NULL */
 } block_t;
 
+/**
+ * struct merkle_proof_s - Proof that a transaction belongs to a block
+ *
+ * @index:     Index of the transaction in the block
+ * @nb_leaves: Number of transactions in the block
+ * @len:       Number of entries in @siblings
+ * @siblings:  Sibling hashes on the path from the leaf to the root
+ */
+typedef struct merkle_proof_s
+{
+	uint32_t index;
+	uint32_t nb_leaves;
+	uint32_t len;
+	uint8_t (*siblings)[SHA256_DIGEST_LENGTH];
+} merkle_proof_t;
+
+/**
+ * struct chain_index_s - Array-backed index of the blocks of a chain
+ *
+ * @blocks:   Blocks by height
+ * @count:    Number of blocks in @blocks
+ * @capacity: Number of entries allocated for @blocks
+ * @slots:    Open-addressing table from block hash to height + 1, 0 marks
+ *            an empty slot
+ * @mask:     Number of slots minus one, the number of slots is a power of 2
+ * @tip:      Hash of the last block in @blocks, tells a chain whose blocks
+ *            were replaced from the one that was indexed
+ */
+typedef struct chain_index_s
+{
+	block_t **blocks;
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t *slots;
+	uint32_t mask;
+	uint8_t tip[SHA256_DIGEST_LENGTH];
+} chain_index_t;
+
+/**
+ * struct write_buf_s - Buffered writer to a file descriptor
+ *
+ * @fd:        File descriptor to write to
+ * @buf:       Page-aligned buffer of WRITE_BUF_SIZE bytes
+ * @len:       Number of bytes pending in @buf
+ * @total:     Number of bytes written or pending so far
+ * @nb_writes: Number of write() calls issued
+ * @failed:    Set when a write fails, further writes are ignored
+ */
+typedef struct write_buf_s
+{
+	int fd;
+	uint8_t *buf;
+	size_t len;
+	uint64_t total;
+	uint32_t nb_writes;
+	int failed;
+} write_buf_t;
+
+/**
+ * struct map_cursor_s - Read position in a mapped file or buffer
+ *
+ * @pos:  Next byte to read
+ * @left: Number of bytes left after @pos
+ * @swap: Set when the data's byte order differs from the host's
+ */
+typedef struct map_cursor_s
+{
+	uint8_t *pos;
+	size_t left;
+	int swap;
+} map_cursor_t;
+
+/**
+ * struct serialize_stats_s - Report of blockchain_serialize_stats
+ *
+ * @bytes:         Size of the file written
+ * @nb_writes:     Number of write() calls issued
+ * @nsec:          Time spent, in nanoseconds
+ * @bytes_per_sec: Throughput, @bytes over @nsec
+ */
+typedef struct serialize_stats_s
+{
+	uint64_t bytes;
+	uint32_t nb_writes;
+	uint64_t nsec;
+	uint64_t bytes_per_sec;
+} serialize_stats_t;
+
+/**
+ * struct block_loc_s - Location of a block in a block store, an entry of
+ * its index file
+ *
+ * @file:   Number of the segment file holding the block
+ * @len:    Length of the block
+ * @offset: Offset of the block in its segment file
+ */
+typedef struct block_loc_s
+{
+	uint32_t file;
+	uint32_t len;
+	uint64_t offset;
+} block_loc_t;
+
+/**
+ * struct block_store_s - Append-only blockchain on disk
+ *
+ * Description: Blocks are appended to segment files blkNNNNN.dat. The
+ * index file blocks.idx holds a header with the block count, then one
+ * block_loc_t per height. Blocks and index entries are written and synced
+ * before the count is, so a reader never sees a block that is not fully
+ * on disk.
+ *
+ * @dir:      Directory of the store
+ * @index_fd: Descriptor of the index file
+ * @count:    Number of blocks stored, as published in the index header
+ * @seg:      Number of the last segment file
+ * @seg_len:  Length of the last segment file, up to its last stored block
+ */
+typedef struct block_store_s
+{
+	char *dir;
+	int index_fd;
+	uint32_t count;
+	uint32_t seg;
+	uint64_t seg_len;
+} block_store_t;
+
+/**
+ * struct block_reader_s - Streaming reader of a blockchain file
+ *
+ * @fd:        Descriptor of the file
+ * @flags:     Flags given to block_reader_open
+ * @nb_blocks: Number of blocks in the file
+ * @next:      Height of the next block to read
+ * @buf:       Read buffer
+ * @cap:       Size of @buf
+ * @pos:       Offset of the first unconsumed byte in @buf
+ * @len:       Number of bytes read into @buf
+ * @file_left: Number of bytes of the file not read yet
+ * @swap:      Set when the file's byte order differs from the host's
+ * @header:    Block yielded with BLOCK_READER_HEADERS, transactions NULL
+ * @block:     Block yielded otherwise, destroyed by the next call
+ * @failed:    Set when the file is truncated or malformed
+ */
+typedef struct block_reader_s
+{
+	int fd;
+	int flags;
+	uint32_t nb_blocks;
+	uint32_t next;
+	uint8_t *buf;
+	size_t cap;
+	size_t pos;
+	size_t len;
+	uint64_t file_left;
+	int swap;
+	block_t header;
+	block_t *block;
+	int failed;
+} block_reader_t;
+
 typedef struct blockchain_s
 {
 	llist_t *chain;	  /* List of block_t * */
-	llist_t *unspent; /* List of unspent_tx_out_t * */
+	utxo_set_t *unspent; /* Set of unspent transaction outputs */
+	chain_index_t *index; /* Mirrors @chain, see blockchain_add_block */
+	void *map;	      /* File mapped by blockchain_deserialize, or NULL */
+	size_t map_len;	      /* Length of @map */
 } blockchain_t;
 
 /* === Blockchain functions === */
@@ -53,19 +258,78 @@ typedef struct blockchain_s
 blockchain_t *blockchain_create(void);
 void blockchain_destroy(blockchain_t *blockchain);
 int blockchain_serialize(blockchain_t const *blockchain, char const *path);
+int blockchain_serialize_stats(blockchain_t const *blockchain,
+	char const *path, serialize_stats_t *stats);
 blockchain_t *blockchain_deserialize(char const *path);
+int blockchain_upgrade(char const *src, char const *dst);
+int blockchain_upgrade_block(map_cursor_t *cur, write_buf_t *w, int first);
 uint32_t blockchain_difficulty(blockchain_t const *blockchain);
+int blockchain_add_block(blockchain_t *blockchain, block_t *block);
+block_t *blockchain_block_at(blockchain_t const *blockchain, uint32_t height);
+block_t *blockchain_block_by_hash(blockchain_t const *blockchain,
+	uint8_t const hash[SHA256_DIGEST_LENGTH]);
+uint32_t blockchain_height(blockchain_t const *blockchain);
+
+chain_index_t *chain_index_create(void);
+void chain_index_destroy(chain_index_t *index);
+int chain_index_add(chain_index_t *index, block_t *block);
+int64_t chain_index_find(chain_index_t const *index,
+	uint8_t const hash[SHA256_DIGEST_LENGTH]);
+void chain_index_clear(chain_index_t *index);
+
+uint8_t _get_endianness(void);
+uint32_t hblk_load32(void const *p, int swap);
+void block_info_bswap(block_info_t *info);
+void block_serialize(write_buf_t *w, block_t const *block);
+block_t *block_deserialize(map_cursor_t *cur, int views);
+uint8_t *map_cursor_take(map_cursor_t *cur, size_t size);
+block_store_t *block_store_open(char const *dir);
+void block_store_close(block_store_t *store);
+int block_store_locate(block_store_t const *store, uint32_t height,
+	block_loc_t *loc);
+int block_store_segment(block_store_t const *store, uint32_t file, int flags);
+block_t *block_store_read(block_store_t const *store, uint32_t height);
+int block_store_append(block_store_t *store, blockchain_t const *blockchain);
+int block_store_publish(block_store_t *store, block_loc_t const *locs,
+	uint32_t nb);
+int block_store_upgrade(char const *src, char const *dst);
+block_reader_t *block_reader_open(char const *path, int flags);
+block_t const *block_reader_next(block_reader_t *reader);
+void block_reader_close(block_reader_t *reader);
+size_t arena_round(size_t size);
+arena_t *arena_create(size_t hint);
+void *arena_alloc(arena_t *arena, size_t size);
+void arena_destroy(arena_t *arena);
+int write_buf_init(write_buf_t *w, int fd);
+void write_buf_put(write_buf_t *w, void const *data, size_t len);
+int write_buf_flush(write_buf_t *w);
+void write_buf_destroy(write_buf_t *w);
 
 block_t *block_create(block_t const *prev,
 		      int8_t const *data, uint32_t data_len);
 void block_destroy(block_t *block);
 uint8_t *block_hash(block_t const *block,
 		    uint8_t hash_buf[SHA256_DIGEST_LENGTH]);
+uint8_t *block_hash_preimage(block_t const *block, size_t *len);
 int hash_matches_difficulty(uint8_t const hash[SHA256_DIGEST_LENGTH],
 			    uint32_t difficulty);
+int hash_matches_target(uint8_t const hash[SHA256_DIGEST_LENGTH],
+			uint8_t const target[SHA256_DIGEST_LENGTH]);
 void block_mine(block_t *block);
+uint8_t (*merkle_leaves(llist_t *transactions,
+	uint32_t *count))[SHA256_DIGEST_LENGTH];
+uint32_t merkle_level(uint8_t (*nodes)[SHA256_DIGEST_LENGTH], uint32_t count);
+uint8_t *merkle_root(llist_t *transactions,
+	uint8_t root[SHA256_DIGEST_LENGTH]);
+merkle_proof_t *merkle_proof_create(llist_t *transactions, uint32_t index);
+int merkle_proof_verify(uint8_t const root[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH], merkle_proof_t const *proof);
+void merkle_proof_destroy(merkle_proof_t *proof);
+void block_mine_mt(block_t *block, unsigned int nb_threads);
 int block_is_valid(block_t const *block,
 		   block_t const *prev_block,
-		   llist_t *all_unspent);
+		   utxo_set_t *all_unspent);
+int block_is_valid_mt(block_t const *block, block_t const *prev_block,
+		      utxo_set_t *all_unspent, unsigned int nb_threads);
 
 #endif /* BLOCKCHAIN_H */
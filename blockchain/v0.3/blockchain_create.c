@@ -13,24 +13,28 @@ blockchain_t *blockchain_create(void)
 	block_t *genesis_block;
 
 	/* Allocate memory for the blockchain structure */
-	blockchain = malloc(sizeof(*blockchain));
+	blockchain = calloc(1, sizeof(*blockchain));
 	if (!blockchain)
 		return (NULL);
 
-	/* Create the chain (linked list) */
+	/* Create the chain (linked list), its index and the unspent set */
 	blockchain->chain = llist_create(MT_SUPPORT_TRUE);
-	if (!blockchain->chain)
+	blockchain->index = chain_index_create();
+	blockchain->unspent = utxo_set_create(0);
+	if (!blockchain->chain || !blockchain->index || !blockchain->unspent)
 	{
-		free(blockchain);
+		blockchain_destroy(blockchain);
 		return (NULL);
 	}
 
 	/* Allocate and initialize the Genesis Block */
-	genesis_block = malloc(sizeof(*genesis_block));
-	if (!genesis_block)
+	genesis_block = calloc(1, sizeof(*genesis_block));
+	if (genesis_block)
+		genesis_block->transactions = llist_create(MT_SUPPORT_FALSE);
+	if (!genesis_block || !genesis_block->transactions)
 	{
-		llist_destroy(blockchain->chain, 1, NULL);
-		free(blockchain);
+		free(genesis_block);
+		blockchain_destroy(blockchain);
 		return (NULL);
 	}
 
@@ -40,21 +44,21 @@ blockchain_t *blockchain_create(void)
 	genesis_block->info.timestamp = 1537578000;
 	genesis_block->info.nonce = 0;
 	memset(genesis_block->info.prev_hash, 0, SHA256_DIGEST_LENGTH);
+	memset(genesis_block->info.merkle_root, 0, SHA256_DIGEST_LENGTH);
 
 	memcpy(genesis_block->data.buffer, "Holberton School", 16);
 	genesis_block->data.len = 16;
 
 	memcpy(genesis_block->hash,
-	       "\xc5\x2c\x26\xc8\xb5\x46\x16\x39\x63\x5d\x8e\xdf\x2a\x97\xd4\x8d"
-	       "\x0c\x8e\x00\x09\xc8\x17\xf2\xb1\xd3\xd7\xff\x2f\x04\x51\x58\x03",
+	       "\x8b\x51\xbd\xf1\xb1\xb4\xf3\xd9\x77\xf0\xce\xd6\x50\x6c\x50\x56"
+	       "\x58\x84\x16\x60\xe6\x25\x62\xdc\x41\x76\xfd\x9e\x33\x98\x77\x30",
 	       SHA256_DIGEST_LENGTH);
 
 	/* Append the Genesis Block to the blockchain */
-	if (llist_add_node(blockchain->chain, genesis_block, ADD_NODE_REAR) == -1)
+	if (blockchain_add_block(blockchain, genesis_block) == -1)
 	{
-		free(genesis_block);
-		llist_destroy(blockchain->chain, 1, NULL);
-		free(blockchain);
+		block_destroy(genesis_block);
+		blockchain_destroy(blockchain);
 		return (NULL);
 	}
 
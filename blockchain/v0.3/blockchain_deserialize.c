@@ -3,159 +3,135 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /**
- * read_transaction - reads a transaction from a file
- * @fd: file descriptor
+ * map_file - Maps a whole file in memory
+ * @path: path to the file
+ * @len: Receives the length of the file
  *
- * Return: pointer to newly created transaction or NULL on failure
+ * Description: The mapping is private: pages written to are copied, the
+ * file is never modified.
+ *
+ * Return: Pointer to the mapping, or NULL on failure
  */
-static transaction_t *read_transaction(int fd)
+static uint8_t *map_file(char const *path, size_t *len)
 {
-	transaction_t *tx;
-	int i, nb_inputs, nb_outputs;
+	struct stat st;
+	void *map;
+	int fd;
 
-	tx = calloc(1, sizeof(*tx));
-	if (!tx)
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
 		return (NULL);
-
-	if (read(fd, tx->id, sizeof(tx->id)) != sizeof(tx->id))
-		goto fail;
-
-	if (read(fd, &nb_inputs, sizeof(int)) != sizeof(int))
-		goto fail;
-
-	tx->inputs = llist_create(MT_SUPPORT_FALSE);
-	if (!tx->inputs)
-		goto fail;
-
-	for (i = 0; i < nb_inputs; i++)
-	{
-		tx_in_t in;
-		if (read(fd, &in, sizeof(in)) != sizeof(in))
-			goto fail;
-
-		if (llist_add_node(tx->inputs, &in, ADD_NODE_REAR) == -1)
-			goto fail;
-	}
-
-	if (read(fd, &nb_outputs, sizeof(int)) != sizeof(int))
-		goto fail;
-
-	tx->outputs = llist_create(MT_SUPPORT_FALSE);
-	if (!tx->outputs)
-		goto fail;
-
-	for (i = 0; i < nb_outputs; i++)
-	{
-		tx_out_t out;
-		if (read(fd, &out, sizeof(out)) != sizeof(out))
-			goto fail;
-
-		if (llist_add_node(tx->outputs, &out, ADD_NODE_REAR) == -1)
-			goto fail;
-	}
-
-	return (tx);
-fail:
-	free(tx);
-	return (NULL);
+	if (fstat(fd, &st) == -1 || st.st_size <= 0)
+		return (close(fd), NULL);
+	*len = (size_t)st.st_size;
+	map = mmap(NULL, *len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return (NULL);
+	madvise(map, *len, MADV_SEQUENTIAL);
+	return (map);
 }
 
 /**
- * deserialize_block - reads a single block from file
- * @fd: file descriptor
+ * load_unspent - Restores the unspent outputs of a loaded blockchain
+ * @blockchain: pointer to blockchain, its set of unspent outputs empty
+ * @path: path of the blockchain file
+ *
+ * Description: The snapshot written next to the file is used when it
+ * matches the last block. Otherwise the transactions of each block are
+ * applied in turn.
  *
- * Return: pointer to newly created block or NULL
+ * Return: 1 on success, 0 on failure
  */
-static block_t *deserialize_block(int fd)
+static int load_unspent(blockchain_t *blockchain, char const *path)
 {
-	block_t *block;
-	uint32_t data_len;
-	int i, nb_tx;
-
-	block = calloc(1, sizeof(*block));
-	if (!block)
-		return (NULL);
-
-	if (read(fd, &block->info, sizeof(block_info_t)) != sizeof(block_info_t))
-		goto fail;
-
-	if (read(fd, &data_len, sizeof(uint32_t)) != sizeof(uint32_t))
-		goto fail;
-
-	block->data.len = data_len;
-
-	if (read(fd, block->data.buffer, data_len) != (ssize_t)data_len)
-		goto fail;
-
-	if (read(fd, block->hash, SHA256_DIGEST_LENGTH) != SHA256_DIGEST_LENGTH)
-		goto fail;
-
-	if (read(fd, &nb_tx, sizeof(int)) != sizeof(int))
-		goto fail;
-
-	block->transactions = llist_create(MT_SUPPORT_FALSE);
-	if (!block->transactions)
-		goto fail;
-
-	for (i = 0; i < nb_tx; i++)
+	char snap[PATH_MAX];
+	uint32_t height = blockchain_height(blockchain), i;
+	block_t *block = height ? blockchain_block_at(blockchain, height - 1) : NULL;
+	utxo_set_t *set = NULL;
+
+	if (block && snprintf(snap, sizeof(snap), "%s%s", path,
+			      UTXO_SNAPSHOT_SUFFIX) < (int)sizeof(snap))
+		set = utxo_snapshot_load(snap, block->hash, height);
+	if (set)
 	{
-		transaction_t *tx = read_transaction(fd);
-		if (!tx || llist_add_node(block->transactions, tx, ADD_NODE_REAR) == -1)
-			goto fail;
+		utxo_set_destroy(blockchain->unspent);
+		blockchain->unspent = set;
+		return (1);
 	}
-
-	return (block);
-fail:
-	free(block);
-	return (NULL);
+	for (i = 0; i < height; i++)
+	{
+		block = blockchain_block_at(blockchain, i);
+		if (!block || !update_unspent(block->transactions, block->hash,
+					      blockchain->unspent))
+			return (0);
+	}
+	return (1);
 }
 
 /**
  * blockchain_deserialize - loads a blockchain from file
  * @path: path to input file
  *
+ * Description: The file is mapped and walked in memory. The mapping is
+ * owned by the blockchain, the inputs of its transactions point into it,
+ * so the loaded blocks must not outlive the blockchain. The set of
+ * unspent outputs is restored by load_unspent.
+ *
  * Return: pointer to blockchain or NULL
  */
 blockchain_t *blockchain_deserialize(char const *path)
 {
-	int fd, i;
-	uint8_t magic[4], version[3], endianness;
-	uint32_t nb_blocks;
+	map_cursor_t cur;
+	uint8_t *map, *p;
+	size_t len;
+	uint32_t nb_blocks, i;
 	blockchain_t *blockchain;
 
-	fd = open(path, O_RDONLY);
-	if (fd < 0)
+	if (!path)
+		return (NULL);
+	map = map_file(path, &len);
+	if (!map)
 		return (NULL);
 
-	if (read(fd, magic, 4) != 4 || memcmp(magic, "HBLK", 4) != 0)
-		return (close(fd), NULL);
-
-	if (read(fd, version, 3) != 3 || memcmp(version, "0.3", 3) != 0)
-		return (close(fd), NULL);
-
-	if (read(fd, &endianness, 1) != 1)
-		return (close(fd), NULL);
-
-	if (read(fd, &nb_blocks, sizeof(nb_blocks)) != sizeof(nb_blocks))
-		return (close(fd), NULL);
+	/* Magic, version, endianness, then the number of blocks */
+	cur.pos = map;
+	cur.left = len;
+	cur.swap = 0;
+	p = map_cursor_take(&cur, 8 + sizeof(nb_blocks));
+	if (!p || memcmp(p, "HBLK" HBLK_VERSION, 7) != 0 ||
+	    (p[7] != 1 && p[7] != 2))
+		return (munmap(map, len), NULL);
+	cur.swap = p[7] != _get_endianness();
+	nb_blocks = hblk_load32(p + 8, cur.swap);
 
 	blockchain = calloc(1, sizeof(*blockchain));
 	if (!blockchain)
-		return (close(fd), NULL);
+		return (munmap(map, len), NULL);
+	blockchain->map = map;
+	blockchain->map_len = len;
 
 	blockchain->chain = llist_create(MT_SUPPORT_FALSE);
-	if (!blockchain->chain)
-		return (free(blockchain), close(fd), NULL);
+	blockchain->index = chain_index_create();
+	blockchain->unspent = utxo_set_create(0);
+	if (!blockchain->chain || !blockchain->index || !blockchain->unspent)
+		return (blockchain_destroy(blockchain), NULL);
 
-	for (i = 0; i < (int)nb_blocks; i++)
+	for (i = 0; i < nb_blocks; i++)
 	{
-		block_t *block = deserialize_block(fd);
-		if (!block || llist_add_node(blockchain->chain, block, ADD_NODE_REAR) == -1)
-			return (close(fd), NULL);
+		block_t *block = block_deserialize(&cur, 1);
+		if (!block || blockchain_add_block(blockchain, block) == -1)
+			return (block_destroy(block), blockchain_destroy(blockchain),
+				NULL);
 	}
 
-	close(fd);
+	if (!load_unspent(blockchain, path))
+		return (blockchain_destroy(blockchain), NULL);
 	return (blockchain);
 }
@@ -1,5 +1,6 @@
 #include "blockchain.h"
 #include <stdlib.h>
+#include <sys/mman.h>
 
 /**
  * blockchain_destroy - Frees an entire blockchain and all its blocks
@@ -11,7 +12,12 @@ void blockchain_destroy(blockchain_t *blockchain)
 		return;
 
 	/* Destroy all blocks in the chain */
-	llist_destroy(blockchain->chain, 1, (node_dtor_t)block_destroy);
+	if (blockchain->chain)
+		llist_destroy(blockchain->chain, 1, (node_dtor_t)block_destroy);
+	chain_index_destroy(blockchain->index);
+	utxo_set_destroy(blockchain->unspent);
+	if (blockchain->map)
+		munmap(blockchain->map, blockchain->map_len);
 
 	/* Free the blockchain structure */
 	free(blockchain);
@@ -9,18 +9,18 @@
 uint32_t blockchain_difficulty(blockchain_t const *blockchain)
 {
 	block_t *last_block, *adjustment_block;
-	int blockchain_size;
+	uint32_t blockchain_size;
 	time_t actual_time, expected_time;
 	uint32_t difficulty;
 
 	if (!blockchain || !blockchain->chain)
 		return (0);
 
-	blockchain_size = llist_size(blockchain->chain);
-	if (blockchain_size == -1)
+	blockchain_size = blockchain_height(blockchain);
+	if (!blockchain_size)
 		return (0);
 
-	last_block = llist_get_tail(blockchain->chain);
+	last_block = blockchain_block_at(blockchain, blockchain_size - 1);
 	if (!last_block)
 		return (0);
 
@@ -30,8 +30,8 @@ uint32_t blockchain_difficulty(blockchain_t const *blockchain)
 	    last_block->info.index % DIFFICULTY_ADJUSTMENT_INTERVAL != 0)
 		return (difficulty);
 
-	adjustment_block = llist_get_node_at(blockchain->chain,
-					     last_block->info.index - DIFFICULTY_ADJUSTMENT_INTERVAL);
+	adjustment_block = blockchain_block_at(blockchain,
+		last_block->info.index - DIFFICULTY_ADJUSTMENT_INTERVAL);
 	if (!adjustment_block)
 		return (difficulty);
 
@@ -0,0 +1,157 @@
+#include "blockchain.h"
+#include <string.h>
+
+/**
+ * index_catch_up - Appends the blocks missing from an index
+ * @node: Pointer to the block_t
+ * @idx: Height of the block
+ * @arg: Index to update
+ *
+ * Return: 0 to keep iterating, 1 to stop on failure
+ */
+static int index_catch_up(llist_node_t node, unsigned int idx, void *arg)
+{
+	chain_index_t *index = arg;
+
+	if (idx < index->count)
+		return (0);
+	return (chain_index_add(index, node) == -1);
+}
+
+/**
+ * block_hash_is - Tells whether a block has a given hash
+ * @node: Pointer to the block_t
+ * @arg: Hash to look for
+ *
+ * Return: 1 if it has, 0 otherwise
+ */
+static int block_hash_is(llist_node_t node, void *arg)
+{
+	block_t const *block = node;
+
+	return (block && !memcmp(block->hash, arg, SHA256_DIGEST_LENGTH));
+}
+
+/**
+ * blockchain_index - Returns the index of a chain, synchronized with it
+ * @blockchain: Pointer to the blockchain
+ *
+ * Description: Blocks appended straight to the chain list are picked up
+ * here in a single walk of the list. The index is rebuilt if the block it
+ * ends with is no longer in the chain at its height, which catches blocks
+ * removed as well as a chain replaced by another of the same length. Like
+ * the list itself, the index is not safe to update from several threads
+ * at once.
+ *
+ * Return: The index, or NULL if the chain has none or it could not be
+ * synchronized
+ */
+static chain_index_t *blockchain_index(blockchain_t const *blockchain)
+{
+	chain_index_t *index;
+	block_t const *tip = NULL;
+	int size;
+
+	if (!blockchain || !blockchain->index || !blockchain->chain)
+		return (NULL);
+	index = blockchain->index;
+	size = llist_size(blockchain->chain);
+	if (size < 0)
+		return (NULL);
+	if ((uint32_t)size == index->count)
+		tip = llist_get_tail(blockchain->chain);
+	else if ((uint32_t)size > index->count && index->count)
+		tip = llist_get_node_at(blockchain->chain, index->count - 1);
+	if (index->count &&
+	    (!tip || memcmp(tip->hash, index->tip, SHA256_DIGEST_LENGTH)))
+		chain_index_clear(index);
+	else if ((uint32_t)size == index->count)
+		return (index);
+	llist_for_each(blockchain->chain, index_catch_up, index);
+	return ((uint32_t)size == index->count ? index : NULL);
+}
+
+/**
+ * blockchain_add_block - Appends a block to a blockchain
+ * @blockchain: Pointer to the blockchain
+ * @block: Block to append, its hash must be final
+ *
+ * Description: The index follows only if it was in sync with the chain,
+ * otherwise blockchain_index rebuilds it on the next lookup.
+ *
+ * Return: 0 on success, -1 on failure
+ */
+int blockchain_add_block(blockchain_t *blockchain, block_t *block)
+{
+	chain_index_t *index;
+	block_t const *tail;
+
+	if (!blockchain || !block)
+		return (-1);
+	tail = llist_get_tail(blockchain->chain);
+	if (llist_add_node(blockchain->chain, block, ADD_NODE_REAR) == -1)
+		return (-1);
+	index = blockchain->index;
+	if (index && index->count + 1 == (uint32_t)llist_size(blockchain->chain) &&
+	    (!index->count || (tail && !memcmp(tail->hash, index->tip,
+					       SHA256_DIGEST_LENGTH))))
+		chain_index_add(index, block);
+	return (0);
+}
+
+/**
+ * blockchain_block_at - Gets the block at a given height
+ * @blockchain: Pointer to the blockchain
+ * @height: Height of the block, 0 being the Genesis Block
+ *
+ * Return: The block, or NULL if there is none at @height
+ */
+block_t *blockchain_block_at(blockchain_t const *blockchain, uint32_t height)
+{
+	chain_index_t *index = blockchain_index(blockchain);
+
+	if (!index)
+		return (blockchain ? llist_get_node_at(blockchain->chain, height)
+			: NULL);
+	return (height < index->count ? index->blocks[height] : NULL);
+}
+
+/**
+ * blockchain_block_by_hash - Finds a block of a blockchain by its hash
+ * @blockchain: Pointer to the blockchain
+ * @hash: Hash of the block
+ *
+ * Description: Without an index in sync, the chain list is searched.
+ *
+ * Return: The block, or NULL if it is not part of the chain
+ */
+block_t *blockchain_block_by_hash(blockchain_t const *blockchain,
+	uint8_t const hash[SHA256_DIGEST_LENGTH])
+{
+	chain_index_t *index = blockchain_index(blockchain);
+	int64_t height;
+
+	if (!index)
+		return (blockchain && blockchain->chain && hash ?
+			llist_find_node(blockchain->chain, block_hash_is,
+					(void *)hash) : NULL);
+	height = chain_index_find(index, hash);
+	return (height < 0 ? NULL : index->blocks[height]);
+}
+
+/**
+ * blockchain_height - Counts the blocks of a blockchain
+ * @blockchain: Pointer to the blockchain
+ *
+ * Return: Number of blocks, Genesis Block included
+ */
+uint32_t blockchain_height(blockchain_t const *blockchain)
+{
+	chain_index_t *index = blockchain_index(blockchain);
+	int size;
+
+	if (index)
+		return (index->count);
+	size = blockchain ? llist_size(blockchain->chain) : -1;
+	return (size < 0 ? 0 : (uint32_t)size);
+}
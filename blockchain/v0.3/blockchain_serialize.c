@@ -4,141 +4,116 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
-
-static uint8_t _get_endianness(void)
-{
-	uint16_t n = 1;
-	return (*(uint8_t *)&n == 1) ? 1 : 2;
-}
+#include <limits.h>
+#include <stdio.h>
+#include <time.h>
 
 /**
- * write_transaction - writes a transaction to a file descriptor
- * @fd: file descriptor
- * @transaction: pointer to transaction to write
+ * save_snapshot - Writes the unspent outputs of a blockchain next to its
+ * file
+ * @blockchain: pointer to blockchain
+ * @path: path of the blockchain file
  *
- * Return: 1 on success, 0 on failure
+ * Description: The snapshot is only written if the set was last applied
+ * to the last block of the chain, or is empty next to the Genesis Block
+ * alone. Otherwise, or if it cannot be written, no snapshot is left and
+ * blockchain_deserialize rebuilds the set from the blocks.
  */
-static int write_transaction(int fd, transaction_t const *transaction)
+static void save_snapshot(blockchain_t const *blockchain, char const *path)
 {
-	int i, nb_inputs, nb_outputs;
-
-	if (!transaction)
-		return (0);
-
-	if (write(fd, transaction->id, sizeof(transaction->id)) != sizeof(transaction->id))
-		return (0);
-
-	nb_inputs = llist_size(transaction->inputs);
-	if (write(fd, &nb_inputs, sizeof(int)) != sizeof(int))
-		return (0);
-
-	for (i = 0; i < nb_inputs; i++)
-	{
-		tx_in_t *in = llist_get_node_at(transaction->inputs, i);
-		if (!in || write(fd, in, sizeof(*in)) != sizeof(*in))
-			return (0);
-	}
-
-	nb_outputs = llist_size(transaction->outputs);
-	if (write(fd, &nb_outputs, sizeof(int)) != sizeof(int))
-		return (0);
-
-	for (i = 0; i < nb_outputs; i++)
-	{
-		tx_out_t *out = llist_get_node_at(transaction->outputs, i);
-		if (!out || write(fd, out, sizeof(*out)) != sizeof(*out))
-			return (0);
-	}
-
-	return (1);
+	char snap[PATH_MAX];
+	uint32_t height = blockchain_height(blockchain);
+	block_t *tip = height ? blockchain_block_at(blockchain, height - 1) : NULL;
+	utxo_set_t const *set = blockchain->unspent;
+
+	if (snprintf(snap, sizeof(snap), "%s%s", path, UTXO_SNAPSHOT_SUFFIX) >=
+	    (int)sizeof(snap))
+		return;
+	if (!tip || !set || (memcmp(set->tip, tip->hash, SHA256_DIGEST_LENGTH) &&
+			     (height != 1 || utxo_set_size(set))) ||
+	    !utxo_snapshot_save(set, tip->hash, height, snap))
+		unlink(snap);
 }
 
 /**
- * serialize_block - writes a single block and its transactions to file
- * @fd: file descriptor
- * @block: pointer to block
- *
- * Return: 1 on success, 0 on failure
- */
-static int serialize_block(int fd, block_t const *block)
-{
-	int i, nb_tx;
-
-	if (write(fd, &block->info, sizeof(block_info_t)) != sizeof(block_info_t))
-		return (0);
-
-	if (write(fd, &block->data.len, sizeof(uint32_t)) != sizeof(uint32_t))
-		return (0);
-
-	if (write(fd, block->data.buffer, block->data.len) != (ssize_t)block->data.len)
-		return (0);
-
-	if (write(fd, block->hash, SHA256_DIGEST_LENGTH) != SHA256_DIGEST_LENGTH)
-		return (0);
-
-	nb_tx = llist_size(block->transactions);
-	if (write(fd, &nb_tx, sizeof(int)) != sizeof(int))
-		return (0);
-
-	for (i = 0; i < nb_tx; i++)
-	{
-		transaction_t *tx = llist_get_node_at(block->transactions, i);
-		if (!write_transaction(fd, tx))
-			return (0);
-	}
-
-	return (1);
-}
-
-/**
- * blockchain_serialize - serializes a blockchain into a file
+ * blockchain_serialize_stats - serializes a blockchain into a file and
+ * reports the throughput
  * @blockchain: pointer to blockchain to serialize
  * @path: path to output file
+ * @stats: receives the size, time and throughput of the write, may be NULL
+ *
+ * Description: The file is assembled in a WRITE_BUF_SIZE buffer, flushed
+ * whenever it fills up. The unspent outputs are then written to a
+ * snapshot file, @path followed by UTXO_SNAPSHOT_SUFFIX, on a best-effort
+ * basis, see save_snapshot.
  *
  * Return: 1 on success, 0 on failure
  */
-int blockchain_serialize(blockchain_t const *blockchain, char const *path)
+int blockchain_serialize_stats(blockchain_t const *blockchain,
+	char const *path, serialize_stats_t *stats)
 {
-	int fd, i;
-	uint32_t nb_blocks;
+	struct timespec start, end;
+	write_buf_t w;
+	int fd, ok;
+	uint32_t nb_blocks, i;
 	const uint8_t magic[4] = {'H', 'B', 'L', 'K'};
-	const uint8_t version[3] = {'0', '.', '3'};
+	const uint8_t version[3] = HBLK_VERSION;
 	uint8_t endianness;
 
 	if (!path || !blockchain)
 		return (0);
 
+	clock_gettime(CLOCK_MONOTONIC, &start);
 	fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0600);
 	if (fd < 0)
 		return (0);
+	if (!write_buf_init(&w, fd))
+		return (close(fd), 0);
 
 	endianness = _get_endianness();
+	write_buf_put(&w, magic, 4);
+	write_buf_put(&w, version, 3);
+	write_buf_put(&w, &endianness, 1);
 
-	if (write(fd, magic, 4) != 4 ||
-	    write(fd, version, 3) != 3 ||
-	    write(fd, &endianness, 1) != 1)
-	{
-		close(fd);
-		return (0);
-	}
+	nb_blocks = blockchain_height(blockchain);
+	write_buf_put(&w, &nb_blocks, sizeof(nb_blocks));
 
-	nb_blocks = (uint32_t)llist_size(blockchain->chain);
-	if (write(fd, &nb_blocks, sizeof(nb_blocks)) != sizeof(nb_blocks))
+	for (i = 0; i < nb_blocks && !w.failed; i++)
 	{
-		close(fd);
-		return (0);
+		block_t *block = blockchain_block_at(blockchain, i);
+
+		if (!block)
+			w.failed = 1;
+		else
+			block_serialize(&w, block);
 	}
 
-	for (i = 0; i < (int)nb_blocks; i++)
+	ok = write_buf_flush(&w);
+	write_buf_destroy(&w);
+	ok = close(fd) == 0 && ok;
+	if (ok)
+		save_snapshot(blockchain, path);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (ok && stats)
 	{
-		block_t *block = llist_get_node_at(blockchain->chain, i);
-		if (!serialize_block(fd, block))
-		{
-			close(fd);
-			return (0);
-		}
+		stats->bytes = w.total;
+		stats->nb_writes = w.nb_writes;
+		stats->nsec = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000 +
+			(uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec;
+		stats->bytes_per_sec = stats->nsec ? (uint64_t)((double)stats->bytes *
+			1e9 / (double)stats->nsec) : 0;
 	}
+	return (ok);
+}
 
-	close(fd);
-	return (1);
-}
\ No newline at end of file
+/**
+ * blockchain_serialize - serializes a blockchain into a file
+ * @blockchain: pointer to blockchain to serialize
+ * @path: path to output file
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int blockchain_serialize(blockchain_t const *blockchain, char const *path)
+{
+	return (blockchain_serialize_stats(blockchain, path, NULL));
+}
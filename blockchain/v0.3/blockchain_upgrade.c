@@ -0,0 +1,190 @@
+#include "blockchain.h"
+#include "transaction.h"
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * upgrade_outputs - Copies the outputs of a transaction, compressing their
+ * public keys
+ * @cur: Cursor in the source file, on the number of outputs
+ * @w: Buffered writer to the destination file
+ *
+ * Description: The amount keeps the byte order of the file and the hash is
+ * kept as is, so the IDs of the transactions do not change.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int upgrade_outputs(map_cursor_t *cur, write_buf_t *w)
+{
+	tx_out_t out;
+	uint8_t *p;
+	int i, nb_outputs;
+
+	p = map_cursor_take(cur, sizeof(int));
+	if (!p)
+		return (0);
+	nb_outputs = (int)hblk_load32(p, cur->swap);
+	if (nb_outputs < 0)
+		return (0);
+	write_buf_put(w, p, sizeof(int));
+	for (i = 0; i < nb_outputs; i++)
+	{
+		p = map_cursor_take(cur, HBLK_V03_OUT);
+		if (!p)
+			return (0);
+		memset(&out, 0, sizeof(out));
+		memcpy(&out.amount, p, sizeof(out.amount));
+		if (!ec_pub_compress(p + sizeof(out.amount), out.pub))
+			return (0);
+		memcpy(out.hash, p + sizeof(out.amount) + EC_PUB_LEN,
+		       SHA256_DIGEST_LENGTH);
+		write_buf_put(w, &out, sizeof(out));
+	}
+	return (1);
+}
+
+/**
+ * upgrade_header_ok - Checks that a block header of a 0.3 file has the
+ * current layout
+ * @header: Header of the block in the file, its data length and data
+ *          following
+ * @data_len: Length of the data
+ * @first: 1 for the Genesis Block, 0 otherwise
+ *
+ * Description: The header is read as it was hashed, in the byte order of
+ * the file. A file written before the Merkle root was added to the header
+ * is misaligned against block_info_t, which this catches: its Genesis
+ * Block does not carry the Genesis data, its other blocks do not hash to
+ * their stored hash.
+ *
+ * Return: 1 if the header is sound, 0 otherwise
+ */
+static int upgrade_header_ok(uint8_t const *header, uint32_t data_len,
+			     int first)
+{
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+	size_t len = sizeof(block_info_t) + sizeof(uint32_t) + data_len;
+
+	if (first)
+		return (data_len == 16 &&
+			!memcmp(header + len - data_len, "Holberton School", 16));
+	sha256((int8_t const *)header, len, digest);
+	return (!memcmp(header + len, digest, SHA256_DIGEST_LENGTH));
+}
+
+/**
+ * blockchain_upgrade_block - Copies a block of a 0.3 file, converting its
+ * outputs
+ * @cur: Cursor in the source file or block store segment, on the block
+ * @w: Buffered writer to the destination file
+ * @first: 1 for the Genesis Block, 0 otherwise
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int blockchain_upgrade_block(map_cursor_t *cur, write_buf_t *w, int first)
+{
+	uint32_t data_len;
+	uint8_t *header, *p;
+	int i, nb_tx, nb_inputs;
+
+	header = map_cursor_take(cur, sizeof(block_info_t) + sizeof(uint32_t));
+	if (!header)
+		return (0);
+	data_len = hblk_load32(header + sizeof(block_info_t), cur->swap);
+	if (data_len > BLOCKCHAIN_DATA_MAX)
+		return (0);
+	write_buf_put(w, header, sizeof(block_info_t) + sizeof(uint32_t));
+	p = map_cursor_take(cur, data_len + SHA256_DIGEST_LENGTH + sizeof(int));
+	if (!p || !upgrade_header_ok(header, data_len, first))
+		return (0);
+	write_buf_put(w, p, data_len + SHA256_DIGEST_LENGTH + sizeof(int));
+	nb_tx = (int)hblk_load32(p + data_len + SHA256_DIGEST_LENGTH, cur->swap);
+
+	for (i = 0; i < nb_tx; i++)
+	{
+		p = map_cursor_take(cur, SHA256_DIGEST_LENGTH + sizeof(int));
+		if (!p)
+			return (0);
+		write_buf_put(w, p, SHA256_DIGEST_LENGTH + sizeof(int));
+		nb_inputs = (int)hblk_load32(p + SHA256_DIGEST_LENGTH, cur->swap);
+		if (nb_inputs < 0)
+			return (0);
+		p = map_cursor_take(cur, (size_t)nb_inputs * sizeof(tx_in_t));
+		if (!p)
+			return (0);
+		write_buf_put(w, p, (size_t)nb_inputs * sizeof(tx_in_t));
+		if (!upgrade_outputs(cur, w))
+			return (0);
+	}
+	return (!w->failed);
+}
+
+/**
+ * blockchain_upgrade - Converts a blockchain file of version 0.3 to the
+ * current version
+ * @src: Path of the 0.3 file
+ * @dst: Path of the file to write
+ *
+ * Description: Version 0.4 stores the public keys of the outputs in
+ * compressed form, see TX_PUB_LEN. Everything else, the endianness byte
+ * included, is copied as is: hashes, signatures and IDs stay valid. The
+ * UTXO snapshot is not converted, blockchain_deserialize rebuilds it. See
+ * block_store_upgrade and utxo_disk_upgrade for the other formats.
+ * Only 0.3 files that already carry a Merkle root in their headers can be
+ * converted: adding the root to an older header changes its hash, which
+ * would take mining every block again. Such files are rejected, and @dst
+ * is removed on failure.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int blockchain_upgrade(char const *src, char const *dst)
+{
+	map_cursor_t cur;
+	write_buf_t w;
+	struct stat st;
+	uint8_t *map, *p;
+	uint32_t nb_blocks, i;
+	int fd, ok;
+
+	if (!src || !dst)
+		return (0);
+	fd = open(src, O_RDONLY);
+	if (fd < 0)
+		return (0);
+	if (fstat(fd, &st) == -1 || st.st_size <= 0)
+		return (close(fd), 0);
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return (0);
+	madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	cur.pos = map;
+	cur.left = (size_t)st.st_size;
+	p = map_cursor_take(&cur, 8 + sizeof(nb_blocks));
+	if (!p || memcmp(p, "HBLK0.3", 7) != 0 || (p[7] != 1 && p[7] != 2))
+		return (munmap(map, (size_t)st.st_size), 0);
+	cur.swap = p[7] != _get_endianness();
+	nb_blocks = hblk_load32(p + 8, cur.swap);
+
+	fd = open(dst, O_CREAT | O_WRONLY | O_TRUNC, 0600);
+	if (fd < 0)
+		return (munmap(map, (size_t)st.st_size), 0);
+	if (!write_buf_init(&w, fd))
+		return (close(fd), munmap(map, (size_t)st.st_size), 0);
+	write_buf_put(&w, "HBLK" HBLK_VERSION, 7);
+	write_buf_put(&w, p + 7, 1 + sizeof(nb_blocks));
+	for (i = 0, ok = 1; i < nb_blocks && ok; i++)
+		ok = blockchain_upgrade_block(&cur, &w, !i);
+
+	ok = write_buf_flush(&w) && ok && !cur.left;
+	write_buf_destroy(&w);
+	ok = close(fd) == 0 && ok;
+	munmap(map, (size_t)st.st_size);
+	if (!ok)
+		unlink(dst);
+	return (ok);
+}
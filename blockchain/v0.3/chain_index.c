@@ -0,0 +1,72 @@
+#include "blockchain.h"
+#include <string.h>
+
+/**
+ * chain_index_create - Creates an empty chain index
+ *
+ * Return: Pointer to the new index, or NULL on failure
+ */
+chain_index_t *chain_index_create(void)
+{
+	return (calloc(1, sizeof(chain_index_t)));
+}
+
+/**
+ * chain_index_clear - Empties a chain index, keeping its allocations
+ * @index: Index to clear
+ *
+ * Description: The blocks themselves are not freed, they belong to the
+ * chain the index mirrors.
+ */
+void chain_index_clear(chain_index_t *index)
+{
+	if (!index)
+		return;
+	index->count = 0;
+	memset(index->tip, 0, SHA256_DIGEST_LENGTH);
+	if (index->slots)
+		memset(index->slots, 0, ((size_t)index->mask + 1) * sizeof(uint32_t));
+}
+
+/**
+ * chain_index_destroy - Frees a chain index
+ * @index: Index to free
+ *
+ * Description: The blocks themselves are not freed, they belong to the
+ * chain the index mirrors.
+ */
+void chain_index_destroy(chain_index_t *index)
+{
+	if (!index)
+		return;
+	free(index->blocks);
+	free(index->slots);
+	free(index);
+}
+
+/**
+ * chain_index_find - Looks up the height of a block by its hash
+ * @index: Index to search
+ * @hash: Hash of the block
+ *
+ * Description: Probing starts from the last word of the hash, the first
+ * ones are zeroed by the proof of work.
+ *
+ * Return: Height of the block, or -1 if it is not indexed
+ */
+int64_t chain_index_find(chain_index_t const *index,
+	uint8_t const hash[SHA256_DIGEST_LENGTH])
+{
+	uint32_t i, slot;
+
+	if (!index || !hash || !index->slots)
+		return (-1);
+	memcpy(&i, hash + SHA256_DIGEST_LENGTH - sizeof(i), sizeof(i));
+	for (i &= index->mask; (slot = index->slots[i]); i = (i + 1) & index->mask)
+	{
+		if (memcmp(index->blocks[slot - 1]->hash, hash,
+			   SHA256_DIGEST_LENGTH) == 0)
+			return (slot - 1);
+	}
+	return (-1);
+}
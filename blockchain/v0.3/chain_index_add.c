@@ -0,0 +1,72 @@
+#include "blockchain.h"
+#include <string.h>
+
+/**
+ * chain_index_insert - Inserts a height in the hash table
+ * @index: Index, its table must have a free slot
+ * @height: Height of an indexed block
+ */
+static void chain_index_insert(chain_index_t *index, uint32_t height)
+{
+	uint32_t i;
+
+	memcpy(&i, index->blocks[height]->hash + SHA256_DIGEST_LENGTH - sizeof(i),
+	       sizeof(i));
+	for (i &= index->mask; index->slots[i]; i = (i + 1) & index->mask)
+		;
+	index->slots[i] = height + 1;
+}
+
+/**
+ * chain_index_grow - Makes room for one more block
+ * @index: Index to grow
+ *
+ * Description: Both the block array and the table double when full, the
+ * table is kept at most half full so that probe sequences stay short.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int chain_index_grow(chain_index_t *index)
+{
+	block_t **blocks;
+	uint32_t *slots, nb_slots, i;
+
+	if (index->count == index->capacity)
+	{
+		i = index->capacity ? index->capacity * 2 : 64;
+		blocks = realloc(index->blocks, i * sizeof(*blocks));
+		if (!blocks)
+			return (0);
+		index->blocks = blocks;
+		index->capacity = i;
+	}
+	if (index->slots && (index->count + 1) * 2 <= index->mask + 1)
+		return (1);
+	nb_slots = index->slots ? (index->mask + 1) * 2 : 128;
+	slots = calloc(nb_slots, sizeof(*slots));
+	if (!slots)
+		return (0);
+	free(index->slots);
+	index->slots = slots;
+	index->mask = nb_slots - 1;
+	for (i = 0; i < index->count; i++)
+		chain_index_insert(index, i);
+	return (1);
+}
+
+/**
+ * chain_index_add - Appends a block to a chain index
+ * @index: Index to append to
+ * @block: Block to append, its hash must be final
+ *
+ * Return: 0 on success, -1 on failure
+ */
+int chain_index_add(chain_index_t *index, block_t *block)
+{
+	if (!index || !block || !chain_index_grow(index))
+		return (-1);
+	index->blocks[index->count] = block;
+	memcpy(index->tip, block->hash, SHA256_DIGEST_LENGTH);
+	chain_index_insert(index, index->count++);
+	return (0);
+}
@@ -0,0 +1,41 @@
+#include "blockchain.h"
+#include <string.h>
+
+/**
+ * _get_endianness - Detects the endianness of the system
+ *
+ * Return: 1 for little endian, 2 for big endian, as in the HBLK header
+ */
+uint8_t _get_endianness(void)
+{
+	uint16_t n = 1;
+
+	return ((*(uint8_t *)&n == 1) ? 1 : 2);
+}
+
+/**
+ * hblk_load32 - Reads a 32-bit field of a blockchain file
+ * @p: Pointer to the field, with no alignment requirement
+ * @swap: Whether the file's byte order differs from the host's
+ *
+ * Return: The field in host order
+ */
+uint32_t hblk_load32(void const *p, int swap)
+{
+	uint32_t x;
+
+	memcpy(&x, p, sizeof(x));
+	return (swap ? __builtin_bswap32(x) : x);
+}
+
+/**
+ * block_info_bswap - Byte-swaps the integer fields of a block header
+ * @info: Block header, read from a file of the other byte order
+ */
+void block_info_bswap(block_info_t *info)
+{
+	info->index = __builtin_bswap32(info->index);
+	info->difficulty = __builtin_bswap32(info->difficulty);
+	info->timestamp = __builtin_bswap64(info->timestamp);
+	info->nonce = __builtin_bswap64(info->nonce);
+}
@@ -1,29 +1,81 @@
 #include "blockchain.h"
+#include <string.h>
+
+/**
+ * load_be64 - Reads a big-endian 64-bit word
+ * @p: Pointer to the 8 bytes to read
+ *
+ * Return: The word in host order
+ */
+static inline uint64_t load_be64(uint8_t const *p)
+{
+	uint64_t x;
+
+	memcpy(&x, p, sizeof(x));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	x = __builtin_bswap64(x);
+#endif
+	return (x);
+}
 
 /**
  * hash_matches_difficulty - Checks if a hash matches a given difficulty
  * @hash: The hash to check
  * @difficulty: Number of leading zero bits required
  *
+ * Description: The hash is read as four big-endian 64-bit words. Whole
+ * words must be zero, the last partial one is checked with a single
+ * count-leading-zeros. Difficulty 0 returns before reading the hash.
+ *
  * Return: 1 if difficulty is matched, 0 otherwise
  */
 int hash_matches_difficulty(uint8_t const hash[SHA256_DIGEST_LENGTH],
 			    uint32_t difficulty)
 {
-	uint32_t bits_checked = 0, i;
-	uint8_t byte;
+	uint64_t word;
+	uint32_t i;
 
-	for (i = 0; i < SHA256_DIGEST_LENGTH && bits_checked < difficulty; i++)
+	if (!difficulty)
+		return (1);
+	if (difficulty > SHA256_DIGEST_LENGTH * 8)
+		difficulty = SHA256_DIGEST_LENGTH * 8;
+
+	for (i = 0; difficulty >= 64; i += 8, difficulty -= 64)
 	{
-		byte = hash[i];
-
-		for (int bit = 7; bit >= 0 &&
-			bits_checked < difficulty; bit--, bits_checked++)
-		{
-			if ((byte >> bit) & 1)
-				return (0);
-		}
+		if (load_be64(hash + i))
+			return (0);
 	}
+	if (!difficulty)
+		return (1);
+
+	word = load_be64(hash + i);
+	return (!word || (uint32_t)__builtin_clzll(word) >= difficulty);
+}
+
+/**
+ * hash_matches_target - Checks if a hash is below or equal to a target
+ * @hash: The hash to check
+ * @target: 256-bit big-endian target
+ *
+ * Description: Both values are compared as 256-bit big-endian integers,
+ * which expresses difficulties finer than a power of two. A target made of
+ * @difficulty zero bits followed by ones is equivalent to
+ * hash_matches_difficulty.
+ *
+ * Return: 1 if @hash <= @target, 0 otherwise
+ */
+int hash_matches_target(uint8_t const hash[SHA256_DIGEST_LENGTH],
+			uint8_t const target[SHA256_DIGEST_LENGTH])
+{
+	uint64_t h, t;
+	uint32_t i;
 
+	for (i = 0; i < SHA256_DIGEST_LENGTH; i += 8)
+	{
+		h = load_be64(hash + i);
+		t = load_be64(target + i);
+		if (h != t)
+			return (h < t);
+	}
 	return (1);
 }
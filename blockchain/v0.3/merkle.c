@@ -0,0 +1,102 @@
+#include "blockchain.h"
+#include <string.h>
+
+/**
+ * merkle_collect - Copies a transaction ID into the leaf array
+ * @node: Pointer to the transaction_t
+ * @idx: Index of the transaction in the list
+ * @arg: Leaf array
+ *
+ * Return: 0 to keep iterating
+ */
+static int merkle_collect(llist_node_t node, unsigned int idx, void *arg)
+{
+	transaction_t const *tx = node;
+	uint8_t (*leaves)[SHA256_DIGEST_LENGTH] = arg;
+
+	if (tx)
+		memcpy(leaves[idx], tx->id, SHA256_DIGEST_LENGTH);
+	else
+		memset(leaves[idx], 0, SHA256_DIGEST_LENGTH);
+	return (0);
+}
+
+/**
+ * merkle_leaves - Gathers the transaction IDs of a list in one walk
+ * @transactions: List of transaction_t *
+ * @count: Receives the number of leaves
+ *
+ * Return: Newly allocated array of @count IDs, or NULL on failure or when
+ * the list is empty
+ */
+uint8_t (*merkle_leaves(llist_t *transactions,
+	uint32_t *count))[SHA256_DIGEST_LENGTH]
+{
+	uint8_t (*leaves)[SHA256_DIGEST_LENGTH];
+	int size = llist_size(transactions);
+
+	*count = 0;
+	if (size <= 0)
+		return (NULL);
+	leaves = malloc((size_t)size * SHA256_DIGEST_LENGTH);
+	if (!leaves)
+		return (NULL);
+	llist_for_each(transactions, merkle_collect, leaves);
+	*count = (uint32_t)size;
+	return (leaves);
+}
+
+/**
+ * merkle_level - Replaces a level of the tree by its parent level, in place
+ * @nodes: Nodes of the level
+ * @count: Number of nodes, at least 2
+ *
+ * Description: Pairs are hashed as SHA-256(left || right) and a node left
+ * without a sibling is promoted unchanged. Leaves and inner nodes are not
+ * told apart, so a list whose first IDs are replaced by the hash of the
+ * pair shares the root of the original list. No valid transaction has
+ * such an ID: an inner node has a 64-byte preimage, and a transaction
+ * needs an input, which makes its preimage at least 96 + 32 bytes long.
+ *
+ * Return: Number of nodes in the parent level
+ */
+uint32_t merkle_level(uint8_t (*nodes)[SHA256_DIGEST_LENGTH], uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i + 1 < count; i += 2)
+		sha256((int8_t const *)nodes[i], 2 * SHA256_DIGEST_LENGTH,
+		       nodes[i / 2]);
+	if (count & 1)
+		memmove(nodes[count / 2], nodes[count - 1], SHA256_DIGEST_LENGTH);
+	return ((count + 1) / 2);
+}
+
+/**
+ * merkle_root - Computes the Merkle root of a list of transactions
+ * @transactions: List of transaction_t *, leaves are their IDs
+ * @root: Receives the root
+ *
+ * Description: The root of an empty list is all zeroes, the root of a
+ * single transaction is its ID.
+ *
+ * Return: Pointer to @root, or NULL on failure
+ */
+uint8_t *merkle_root(llist_t *transactions,
+	uint8_t root[SHA256_DIGEST_LENGTH])
+{
+	uint8_t (*nodes)[SHA256_DIGEST_LENGTH];
+	uint32_t count;
+
+	if (!root)
+		return (NULL);
+	memset(root, 0, SHA256_DIGEST_LENGTH);
+	nodes = merkle_leaves(transactions, &count);
+	if (!nodes)
+		return (llist_size(transactions) > 0 ? NULL : root);
+	while (count > 1)
+		count = merkle_level(nodes, count);
+	memcpy(root, nodes[0], SHA256_DIGEST_LENGTH);
+	free(nodes);
+	return (root);
+}
@@ -0,0 +1,85 @@
+#include "blockchain.h"
+#include <string.h>
+
+/**
+ * merkle_proof_create - Builds the inclusion proof of a transaction
+ * @transactions: List of transaction_t * of a block
+ * @index: Index of the transaction in @transactions
+ *
+ * Description: The proof holds the sibling of every node on the path from
+ * the leaf to the root, levels where the node is promoted without a
+ * sibling contribute nothing.
+ *
+ * Return: Newly allocated proof, or NULL on failure
+ */
+merkle_proof_t *merkle_proof_create(llist_t *transactions, uint32_t index)
+{
+	uint8_t (*nodes)[SHA256_DIGEST_LENGTH];
+	merkle_proof_t *proof;
+	uint32_t count, idx = index;
+
+	nodes = merkle_leaves(transactions, &count);
+	if (!nodes || index >= count)
+		return (free(nodes), NULL);
+	proof = calloc(1, sizeof(*proof));
+	if (proof)
+		proof->siblings = malloc(MERKLE_DEPTH_MAX * SHA256_DIGEST_LENGTH);
+	if (!proof || !proof->siblings)
+		return (free(nodes), free(proof), NULL);
+	proof->index = index;
+	proof->nb_leaves = count;
+	for (; count > 1; idx /= 2)
+	{
+		if ((idx ^ 1U) < count)
+			memcpy(proof->siblings[proof->len++], nodes[idx ^ 1U],
+			       SHA256_DIGEST_LENGTH);
+		count = merkle_level(nodes, count);
+	}
+	free(nodes);
+	return (proof);
+}
+
+/**
+ * merkle_proof_verify - Checks that a transaction belongs to a Merkle root
+ * @root: Merkle root, e.g. block_info_t.merkle_root
+ * @tx_id: ID of the transaction
+ * @proof: Proof created with merkle_proof_create
+ *
+ * Return: 1 if @proof links @tx_id to @root, 0 otherwise
+ */
+int merkle_proof_verify(uint8_t const root[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH], merkle_proof_t const *proof)
+{
+	uint8_t pair[2][SHA256_DIGEST_LENGTH], node[SHA256_DIGEST_LENGTH];
+	uint32_t idx, count, used = 0;
+
+	if (!root || !tx_id || !proof || proof->index >= proof->nb_leaves)
+		return (0);
+	memcpy(node, tx_id, SHA256_DIGEST_LENGTH);
+	for (idx = proof->index, count = proof->nb_leaves; count > 1;
+	     idx /= 2, count = (count + 1) / 2)
+	{
+		if ((idx ^ 1U) >= count)
+			continue;
+		if (used >= proof->len)
+			return (0);
+		memcpy(pair[idx & 1U], node, SHA256_DIGEST_LENGTH);
+		memcpy(pair[!(idx & 1U)], proof->siblings[used++],
+		       SHA256_DIGEST_LENGTH);
+		sha256((int8_t const *)pair, sizeof(pair), node);
+	}
+	return (used == proof->len &&
+		memcmp(node, root, SHA256_DIGEST_LENGTH) == 0);
+}
+
+/**
+ * merkle_proof_destroy - Frees an inclusion proof
+ * @proof: Proof to free
+ */
+void merkle_proof_destroy(merkle_proof_t *proof)
+{
+	if (!proof)
+		return;
+	free(proof->siblings);
+	free(proof);
+}
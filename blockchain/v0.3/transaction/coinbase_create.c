@@ -12,9 +12,9 @@ transaction_t *coinbase_create(EC_KEY const *receiver, uint32_t block_index)
 {
 	transaction_t *tx;
 	tx_in_t *input;
-	tx_out_t *output;
-	llist_t *inputs, *outputs;
-	uint8_t pub[EC_PUB_LEN];
+	tx_out_t *output = NULL;
+	llist_t *inputs = NULL, *outputs = NULL;
+	uint8_t pub[TX_PUB_LEN];
 
 	if (!receiver)
 		return (NULL);
@@ -28,14 +28,19 @@ transaction_t *coinbase_create(EC_KEY const *receiver, uint32_t block_index)
 	/* Create lists */
 	inputs = llist_create(MT_SUPPORT_FALSE);
 	outputs = llist_create(MT_SUPPORT_FALSE);
-	if (!inputs || !outputs || llist_add_node(inputs, input, ADD_NODE_REAR) == -1)
+	if (!inputs || !outputs ||
+	    llist_add_node(inputs, input, ADD_NODE_REAR) == -1)
 		goto fail;
+	/* Owned by @inputs from here on */
+	input = NULL;
 
 	/* Create output to receiver */
-	ec_to_pub(receiver, pub);
+	if (!ec_to_pub_compressed(receiver, pub))
+		goto fail;
 	output = tx_out_create(COINBASE_AMOUNT, pub);
 	if (!output || llist_add_node(outputs, output, ADD_NODE_REAR) == -1)
 		goto fail;
+	output = NULL;
 
 	/* Create transaction */
 	tx = calloc(1, sizeof(*tx));
@@ -51,7 +56,9 @@ transaction_t *coinbase_create(EC_KEY const *receiver, uint32_t block_index)
 fail:
 	free(input);
 	free(output);
-	llist_destroy(inputs, 1, free);
-	llist_destroy(outputs, 1, free);
+	if (inputs)
+		llist_destroy(inputs, 1, free);
+	if (outputs)
+		llist_destroy(outputs, 1, free);
 	return (NULL);
 }
@@ -2,10 +2,6 @@
 #include "hblk_crypto.h"
 #include <string.h>
 
-#ifndef SIG_MAX_LEN
-#define SIG_MAX_LEN 72
-#endif
-
 /**
  * coinbase_is_valid - validates a coinbase transaction
  * @coinbase: pointer to the coinbase transaction
@@ -27,14 +23,13 @@ int coinbase_is_valid(transaction_t const *coinbase, uint32_t block_index)
 	input = llist_get_node_at(coinbase->inputs, 0);
 	output = llist_get_node_at(coinbase->outputs, 0);
 
-	if (!input || !output)
+	if (!input || !output || ec_pub_len(output->pub) != TX_PUB_LEN)
 		return (0);
 
 	/* Check input fields are zeroed and tx_out_hash starts with block_index */
 	if (memcmp(input->block_hash, (uint8_t[SHA256_DIGEST_LENGTH]){0}, SHA256_DIGEST_LENGTH) != 0 ||
 	    memcmp(input->tx_id, (uint8_t[SHA256_DIGEST_LENGTH]){0}, SHA256_DIGEST_LENGTH) != 0 ||
 	    input->sig.len != 0 ||
-	    memcmp(input->sig.sig, (uint8_t[SIG_MAX_LEN]){0}, SIG_MAX_LEN) != 0 ||
 	    memcmp(input->tx_out_hash, &block_index, sizeof(block_index)) != 0)
 		return (0);
 
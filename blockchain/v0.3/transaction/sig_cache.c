@@ -0,0 +1,112 @@
+#include "transaction.h"
+#include <string.h>
+
+/* Each slot holds a key as four words, an all-zero first word marks it empty */
+static uint64_t sig_cache[SIG_CACHE_SLOTS][4];
+static sig_cache_stats_t sig_cache_counters;
+
+/**
+ * sig_cache_key - Computes the cache key of a signature check
+ * @check: Signature check
+ * @key: Receives the key
+ *
+ * Description: The key is the SHA-256 digest of the transaction ID, the
+ * input index, the public key and the signature.
+ */
+void sig_cache_key(sig_check_t const *check, uint8_t key[SHA256_DIGEST_LENGTH])
+{
+	sha256_ctx_t ctx;
+	uint8_t len = check->sig->len;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, check->msg, SHA256_DIGEST_LENGTH);
+	sha256_update(&ctx, &check->index, sizeof(check->index));
+	sha256_update(&ctx, check->pub, TX_PUB_LEN);
+	sha256_update(&ctx, &len, sizeof(len));
+	sha256_update(&ctx, check->sig->sig, len);
+	sha256_final(&ctx, key);
+}
+
+/**
+ * sig_cache_contains - Tells whether a signature check already passed
+ * @key: Key of the check, from sig_cache_key
+ *
+ * Description: Lock-free. A key can be read while another thread
+ * overwrites its slot, word by word. Such a torn read matches @key only
+ * if halves of two cached keys do, which is as unlikely as a 128-bit
+ * collision.
+ *
+ * Return: 1 if the check is cached, 0 otherwise
+ */
+int sig_cache_contains(uint8_t const key[SHA256_DIGEST_LENGTH])
+{
+	uint64_t w[4], slot;
+	unsigned int i, j;
+
+	memcpy(w, key, sizeof(w));
+	for (i = 0; i < 2; i++)
+	{
+		slot = w[i] & (SIG_CACHE_SLOTS - 1);
+		for (j = 0; j < 4; j++)
+			if (__atomic_load_n(&sig_cache[slot][j], __ATOMIC_RELAXED) != w[j])
+				break;
+		if (j == 4)
+		{
+			__atomic_add_fetch(&sig_cache_counters.hits, 1, __ATOMIC_RELAXED);
+			return (1);
+		}
+	}
+	__atomic_add_fetch(&sig_cache_counters.misses, 1, __ATOMIC_RELAXED);
+	return (0);
+}
+
+/**
+ * sig_cache_add - Records a signature check that passed
+ * @key: Key of the check, from sig_cache_key
+ *
+ * Description: A key may live in two slots, chosen by its first two words.
+ * An empty one is preferred, otherwise a bit of the key picks the slot to
+ * overwrite.
+ */
+void sig_cache_add(uint8_t const key[SHA256_DIGEST_LENGTH])
+{
+	uint64_t w[4], slot[2];
+	unsigned int i, j;
+
+	memcpy(w, key, sizeof(w));
+	if (!w[0])
+		return; /* Would read as an empty slot */
+	slot[0] = w[0] & (SIG_CACHE_SLOTS - 1);
+	slot[1] = w[1] & (SIG_CACHE_SLOTS - 1);
+	i = __atomic_load_n(&sig_cache[slot[0]][0], __ATOMIC_RELAXED) == 0 ? 0 :
+		__atomic_load_n(&sig_cache[slot[1]][0], __ATOMIC_RELAXED) == 0 ? 1 :
+		(unsigned int)(w[2] >> 63);
+	for (j = 0; j < 4; j++)
+		__atomic_store_n(&sig_cache[slot[i]][j], w[j], __ATOMIC_RELAXED);
+}
+
+/**
+ * sig_cache_stats - Reads the counters of the signature cache
+ * @stats: Receives the counters
+ */
+void sig_cache_stats(sig_cache_stats_t *stats)
+{
+	if (!stats)
+		return;
+	stats->hits = __atomic_load_n(&sig_cache_counters.hits, __ATOMIC_RELAXED);
+	stats->misses = __atomic_load_n(&sig_cache_counters.misses,
+					__ATOMIC_RELAXED);
+}
+
+/**
+ * sig_cache_clear - Empties the signature cache and resets its counters
+ */
+void sig_cache_clear(void)
+{
+	size_t i;
+
+	for (i = 0; i < SIG_CACHE_SLOTS; i++)
+		__atomic_store_n(&sig_cache[i][0], 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&sig_cache_counters.hits, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&sig_cache_counters.misses, 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,127 @@
+#include "transaction.h"
+#include <pthread.h>
+#include <unistd.h>
+
+/**
+ * struct sig_pool_s - Signature checks shared by a pool of workers
+ *
+ * @checks:     Checks to run
+ * @count:      Number of checks
+ * @next:       Index of the next check to hand out
+ * @first_fail: Lowest index of a failed check, @count if none failed
+ */
+typedef struct sig_pool_s
+{
+	sig_check_t const *checks;
+	size_t count;
+	size_t next;
+	size_t first_fail;
+} sig_pool_t;
+
+/**
+ * sig_check_one - Verifies one signature
+ * @check: Check to run
+ *
+ * Description: Checks that passed are remembered in the signature cache,
+ * so a transaction verified on admission is not verified again when its
+ * block is connected.
+ *
+ * Return: 1 if the signature is valid, 0 otherwise
+ */
+static int sig_check_one(sig_check_t const *check)
+{
+	uint8_t cache_key[SHA256_DIGEST_LENGTH];
+	EC_KEY *key;
+	int ok;
+
+	sig_cache_key(check, cache_key);
+	if (sig_cache_contains(cache_key))
+		return (1);
+	key = ec_from_pub_cached(check->pub, TX_PUB_LEN);
+	ok = key && ec_verify(key, check->msg, SHA256_DIGEST_LENGTH,
+			      check->sig) == 1;
+	ec_key_release(key);
+	if (ok)
+		sig_cache_add(cache_key);
+	return (ok);
+}
+
+/**
+ * sig_worker - Runs checks of a pool until none is left
+ * @arg: Pointer to the sig_pool_t
+ *
+ * Description: Checks are handed out in increasing order. Once a check
+ * failed, the ones after it are skipped but the ones before it still
+ * run, so the lowest failing index is always found.
+ *
+ * Return: NULL
+ */
+static void *sig_worker(void *arg)
+{
+	sig_pool_t *pool = arg;
+	size_t i, fail;
+
+	for (;;)
+	{
+		i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+		if (i >= pool->count ||
+		    i > __atomic_load_n(&pool->first_fail, __ATOMIC_RELAXED))
+			break;
+		if (sig_check_one(&pool->checks[i]))
+			continue;
+		fail = __atomic_load_n(&pool->first_fail, __ATOMIC_RELAXED);
+		while (i < fail &&
+		       !__atomic_compare_exchange_n(&pool->first_fail, &fail, i, 0,
+						    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			;
+	}
+	return (NULL);
+}
+
+/**
+ * sig_checks_run - Verifies a batch of signatures
+ * @checks: Checks to run
+ * @count: Number of checks
+ * @nb_threads: Number of threads to use, 0 to use every online CPU
+ *
+ * Description: The calling thread takes part in the work. The result
+ * does not depend on @nb_threads nor on scheduling.
+ *
+ * Return: Index of the first check that fails, or -1 if all pass
+ */
+int64_t sig_checks_run(sig_check_t const *checks, size_t count,
+	unsigned int nb_threads)
+{
+	sig_pool_t pool;
+	pthread_t *threads = NULL;
+	unsigned char *started = NULL;
+	unsigned int i;
+	long nb_cpus;
+
+	if (!checks && count)
+		return (0);
+	if (!nb_threads)
+	{
+		nb_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nb_threads = nb_cpus > 0 ? (unsigned int)nb_cpus : 1;
+	}
+	if (nb_threads > count)
+		nb_threads = count ? (unsigned int)count : 1;
+	pool.checks = checks;
+	pool.count = count;
+	pool.next = 0;
+	pool.first_fail = count;
+	if (nb_threads > 1)
+	{
+		threads = calloc(nb_threads, sizeof(*threads));
+		started = calloc(nb_threads, sizeof(*started));
+	}
+	for (i = 1; threads && started && i < nb_threads; i++)
+		started[i] = !pthread_create(&threads[i], NULL, sig_worker, &pool);
+	sig_worker(&pool);
+	for (i = 1; threads && started && i < nb_threads; i++)
+		if (started[i])
+			pthread_join(threads[i], NULL);
+	free(threads), free(started);
+	return (pool.first_fail == count ? -1 : (int64_t)pool.first_fail);
+}
@@ -5,25 +5,59 @@
 #include <stdint.h>
 #include <openssl/ec.h>
 #include <openssl/sha.h>
+
+/* Declared ahead of blockchain.h, which refers to it */
+typedef struct utxo_set_s utxo_set_t;
+
 #include "blockchain.h"
 #include "llist.h"
-#include "hblk_crypto.h" /* for EC_PUB_LEN, sig_t */
+#include "hblk_crypto.h" /* for EC_PUB_COMPRESSED_LEN, sig_t */
 
 typedef struct transaction_s transaction_t;
 
-#define SIG_MAX_LEN 72
+/* Public keys in transactions are compressed, see ec_to_pub_compressed */
+#define TX_PUB_LEN EC_PUB_COMPRESSED_LEN
+
+/* Number of slots of the signature cache, a power of 2 */
+#define SIG_CACHE_SLOTS (1 << 16)
+
+/* Magic, version, endianness, tip hash, height and count of a UTXO snapshot */
+#define UTXO_SNAPSHOT_HEADER 48
+#define UTXO_SNAPSHOT_VERSION "0.4"
+
+/* Layout of the file of a disk-backed UTXO set, see utxo_disk_open */
+#define UTXO_DISK_HEADER 64
+#define UTXO_DISK_VERSION "0.4"
+#define UTXO_DISK_V03_REC 184 /* Size of a record of a 0.3 file */
+#define UTXO_DISK_SLOTS 1024 /* Initial number of slots, a power of 2 */
+#define UTXO_DISK_SCAN 4096 /* Records read at once by utxo_disk_scan */
+#define UTXO_DISK_PROBE 16 /* Records read at once when probing the file */
+#define UTXO_JOURNAL_HEADER 72 /* See utxo_journal_commit */
+#define UTXO_JOURNAL_VERSION "0.1"
+#define UTXO_JOURNAL_SLOTS 256 /* Initial capacity of a journal, a power of 2 */
+
+/* States of a cached entry of a disk-backed set, 0 for an in-memory set */
+#define UTXO_DIRTY 1 /* Inserted since the last flush */
+#define UTXO_ON_DISK 2 /* The disk holds a record for the key */
+#define UTXO_DELETED 4 /* Erased since the last flush, kept as a tombstone */
+#define UTXO_PENDING (UTXO_DIRTY | UTXO_DELETED) /* Listed for the next flush */
+
+/* Null entry index or ID of the compact tables of a set */
+#define UTXO_NONE UINT32_MAX
+#define UTXO_CHUNK 4096 /* Entries allocated at once by a set, a power of 2 */
+#define UTXO_TX_KEY (SHA256_DIGEST_LENGTH + 4) /* Transaction ID, block ID */
 
 /**
  * struct tx_out_s - Transaction output
  *
  * @amount: Amount received
- * @pub:    Receiver's public address
+ * @pub:    Receiver's public key, in compressed form
  * @hash:   Hash of @amount and @pub. Serves as output ID
  */
 typedef struct tx_out_s
 {
     uint32_t    amount;
-    uint8_t     pub[EC_PUB_LEN];
+    uint8_t     pub[TX_PUB_LEN];
     uint8_t     hash[SHA256_DIGEST_LENGTH];
 } tx_out_t;
 
@@ -75,16 +109,16 @@ typedef struct unspent_tx_out_s
  * @needed: the amount needed for this transaction
  * @txt: pointer to the transaction struct
  * @sender: the private key
- * @all_unspent: the pointer to the unspent list
+ * @all_unspent: the pointer to the unspent set
  */
 typedef struct tx_data_s
 {
-	uint8_t pub[EC_PUB_LEN];
+	uint8_t pub[TX_PUB_LEN];
 	uint32_t amount_total;
 	uint32_t needed;
 	transaction_t *txt;
 	EC_KEY const *sender;
-	llist_t *all_unspent;
+	utxo_set_t *all_unspent;
 } tx_data_t;
 /**
  * struct transaction_s - Full transaction structure
@@ -92,14 +126,275 @@ typedef struct tx_data_s
  * @id: Hash of this transaction
  * @inputs: List of inputs (tx_in_t *)
  * @outputs: List of outputs (tx_out_t *)
+ * @inputs_mapped: Set when the inputs point into the file mapping of a
+ *                 blockchain, which owns them
+ * @in_arena: Set when the transaction, its inputs and its outputs belong
+ *            to the arena of its block, freed by block_destroy
  */
 typedef struct transaction_s
 {
 	uint8_t id[SHA256_DIGEST_LENGTH];
 	llist_t *inputs;
 	llist_t *outputs;
+	int inputs_mapped;
+	int in_arena;
 } transaction_t;
 
+/**
+ * struct utxo_entry_s - Unspent output stored in a set, in compact form
+ *
+ * Description: The public key, transaction ID and block hash of the
+ * output are interned in the tables of the set and referred to by ID.
+ *
+ * @out_hash:   Hash of the output
+ * @amount:     Amount of the output
+ * @key:        ID of the owner's public key in the key table of the set
+ * @tx:         ID of the transaction in the transaction table of the set
+ * @owner_prev: Index of the previous entry of the same owner, UTXO_NONE
+ *              for the first one
+ * @owner_next: Index of the next entry of the same owner, UTXO_NONE for the
+ *              last one. Chains the free entries together
+ * @state:      UTXO_DIRTY, UTXO_ON_DISK and UTXO_DELETED flags, tombstones
+ *              are not linked to their owner
+ */
+typedef struct utxo_entry_s
+{
+	uint8_t out_hash[SHA256_DIGEST_LENGTH];
+	uint32_t amount;
+	uint32_t key;
+	uint32_t tx;
+	uint32_t owner_prev;
+	uint32_t owner_next;
+	uint32_t state;
+} utxo_entry_t;
+
+/**
+ * struct utxo_slot_s - Slot of the unspent output set
+ *
+ * @fp:    Low half of the fingerprint of the key of @entry, compared
+ *         before the key itself
+ * @entry: Index of the entry plus one, 0 if the slot is empty
+ */
+typedef struct utxo_slot_s
+{
+	uint32_t fp;
+	uint32_t entry;
+} utxo_slot_t;
+
+/**
+ * struct utxo_intern_s - Table of keys stored once and referred to by ID
+ *
+ * Description: Keys are reference counted, an ID stays valid until its
+ * last reference is released, then gets reused.
+ *
+ * @keys:    Keys by ID, @key_len bytes each
+ * @refs:    Number of references by ID, 0 for a free ID
+ * @vals:    Value attached to each ID by the user of the table. Chains the
+ *           free IDs together
+ * @slots:   Open-addressing table of ID + 1, 0 marks an empty slot
+ * @key_len: Length of a key, at least 8 bytes
+ * @mask:    Number of slots minus one, the number of slots is a power of 2
+ * @count:   Number of IDs in use
+ * @nb_ids:  Number of IDs handed out so far, free ones included
+ * @cap:     Number of IDs allocated for @keys, @refs and @vals
+ * @free_id: First free ID below @nb_ids, or UTXO_NONE
+ */
+typedef struct utxo_intern_s
+{
+	uint8_t *keys;
+	uint32_t *refs;
+	uint32_t *vals;
+	uint32_t *slots;
+	size_t key_len;
+	uint32_t mask;
+	uint32_t count;
+	uint32_t nb_ids;
+	uint32_t cap;
+	uint32_t free_id;
+} utxo_intern_t;
+
+/**
+ * struct utxo_rec_s - Slot of the file of a disk-backed set
+ *
+ * @fp:   Fingerprint of the key of @utxo
+ * @used: Non-zero if the slot holds an output
+ * @utxo: The unspent output
+ */
+typedef struct utxo_rec_s
+{
+	uint64_t fp;
+	uint64_t used;
+	unspent_tx_out_t utxo;
+} utxo_rec_t;
+
+/**
+ * struct utxo_journal_s - Slots written to a disk-backed table while a
+ * flush is prepared
+ *
+ * Description: The images of the slots are kept in memory, and read back
+ * in place of the file, until utxo_journal_commit writes them out.
+ *
+ * @slots: Index in the table of each image
+ * @recs:  Images of the slots
+ * @count: Number of images
+ * @index: Positions plus one of the images, by slot index, 0 if empty
+ * @mask:  Number of entries of @index minus one, twice the capacity of
+ *         @slots and @recs
+ * @saved: Number of outputs of the table when the journal was begun
+ */
+typedef struct utxo_journal_s
+{
+	uint64_t *slots;
+	utxo_rec_t *recs;
+	size_t count;
+	uint32_t *index;
+	size_t mask;
+	uint64_t saved;
+} utxo_journal_t;
+
+/**
+ * struct utxo_disk_s - Linear-probing table of unspent outputs in a file
+ *
+ * Description: The file holds a UTXO_DISK_HEADER byte header, "HBLD",
+ * UTXO_DISK_VERSION, the endianness byte, the number of slots and of outputs,
+ * then the hash and the height of the tip the records match, zeroed when
+ * unknown. The slots follow as utxo_rec_t records. Erasing shifts the
+ * following records back, as in memory, and the table doubles through a
+ * temporary file once half full. Records only change through a journal,
+ * see utxo_journal_commit.
+ *
+ * @fd:       Descriptor of the file
+ * @path:     Path of the file
+ * @nb_slots: Number of slots, a power of 2
+ * @count:    Number of outputs in the file
+ * @tip:      Hash of the tip of the file
+ * @height:   Height of the tip of the file, see utxo_set_s
+ * @journal:  Journal of the flush being prepared, NULL outside a flush
+ * @pending:  Set while a committed journal is not fully written out
+ */
+typedef struct utxo_disk_s
+{
+	int fd;
+	char *path;
+	uint64_t nb_slots;
+	uint64_t count;
+	uint8_t tip[SHA256_DIGEST_LENGTH];
+	uint32_t height;
+	utxo_journal_t *journal;
+	int pending;
+} utxo_disk_t;
+
+/**
+ * struct utxo_set_s - Set of unspent transaction outputs
+ *
+ * Description: Unspent outputs are keyed on (block_hash, tx_id,
+ * out.hash) and stored in a linear-probing table of entry indices.
+ * Entries live in chunks of UTXO_CHUNK, so their indices never move.
+ * Public keys, transactions and block hashes are interned, each once for
+ * all its outputs. The outputs of an owner are chained together from
+ * the value of its key. Outputs are only handed out by copy, so that
+ * their storage stays private to the set.
+ *
+ * A set opened with utxo_set_open is backed by a file, the table then
+ * caches the outputs inserted or erased since the last flush and the
+ * outputs last looked up on disk. See utxo_set_checkpoint.
+ *
+ * @slots:       Table of 2^n slots, at most half of them in use
+ * @mask:        Number of slots minus one
+ * @count:       Number of unspent outputs in the set
+ * @nb_entries:  Number of entries in @slots, tombstones included
+ * @chunks:      Entries, by index over UTXO_CHUNK
+ * @nb_chunks:   Number of chunks allocated
+ * @free_entry:  First free entry, or UTXO_NONE
+ * @keys:        Public keys of the owners, valued with their first entry
+ * @txs:         Transaction IDs followed by the ID of their block
+ * @blocks:      Block hashes. IDs are handed out as blocks are first seen
+ *               and reused once their last output is gone, they are not
+ *               heights
+ * @disk:        Backing file, NULL for an in-memory set
+ * @max_bytes:   Memory past which a block boundary flushes the set, see
+ *               utxo_set_bytes and utxo_set_checkpoint
+ * @evict_pos:   Slot where the next eviction starts looking
+ * @dirty:       Entries inserted or erased since the last flush, they are
+ *               only freed by utxo_set_flush
+ * @nb_dirty:    Number of entries in @dirty
+ * @dirty_cap:   Number of entries allocated for @dirty
+ * @tip:         Hash of the last block applied with utxo_set_apply, zeroed
+ *               if there is none or it is not known
+ * @height:      Number of blocks applied up to @tip, 0 with a zeroed @tip
+ */
+struct utxo_set_s
+{
+	utxo_slot_t *slots;
+	size_t mask;
+	size_t count;
+	size_t nb_entries;
+	utxo_entry_t **chunks;
+	uint32_t nb_chunks;
+	uint32_t free_entry;
+	utxo_intern_t keys;
+	utxo_intern_t txs;
+	utxo_intern_t blocks;
+	utxo_disk_t *disk;
+	size_t max_bytes;
+	size_t evict_pos;
+	uint32_t *dirty;
+	size_t nb_dirty;
+	size_t dirty_cap;
+	uint8_t tip[SHA256_DIGEST_LENGTH];
+	uint32_t height;
+};
+
+/**
+ * struct utxo_undo_s - Undo record of a block applied to a set of
+ * unspent outputs
+ *
+ * @spent:       Copies of the outputs spent by the block
+ * @nb_spent:    Number of entries in @spent
+ * @capacity:    Number of entries allocated for @spent
+ * @prev_tip:    Tip of the set before the block was applied
+ * @prev_height: Height of @prev_tip
+ */
+typedef struct utxo_undo_s
+{
+	unspent_tx_out_t *spent;
+	uint32_t nb_spent;
+	uint32_t capacity;
+	uint8_t prev_tip[SHA256_DIGEST_LENGTH];
+	uint32_t prev_height;
+} utxo_undo_t;
+
+/**
+ * struct sig_check_s - Signature verification to perform
+ *
+ * @pub:   Public key of the signer, owner of the spent output
+ * @msg:   Signed message, the ID of the transaction
+ * @sig:   Signature of the input
+ * @index: Index of the input in its transaction
+ */
+typedef struct sig_check_s
+{
+	uint8_t pub[TX_PUB_LEN];
+	uint8_t const *msg;
+	sig_t const *sig;
+	uint32_t index;
+} sig_check_t;
+
+/**
+ * struct sig_cache_stats_s - Counters of the signature cache
+ *
+ * @hits:   Checks found in the cache
+ * @misses: Checks that had to be verified
+ */
+typedef struct sig_cache_stats_s
+{
+	uint64_t hits;
+	uint64_t misses;
+} sig_cache_stats_t;
+
+/* Called on each unspent output, a non-zero return stops the iteration */
+typedef int (*utxo_func_t)(unspent_tx_out_t const *unspent, void *arg);
+
 /*Transaction functions */
 
 unspent_tx_out_t *unspent_tx_out_create(
@@ -107,20 +402,130 @@ unspent_tx_out_t *unspent_tx_out_create(
     uint8_t tx_id[SHA256_DIGEST_LENGTH],
     tx_out_t const *out);
 
-tx_out_t *tx_out_create(uint32_t amount, uint8_t const pub[EC_PUB_LEN]);
+tx_out_t *tx_out_create(uint32_t amount, uint8_t const pub[TX_PUB_LEN]);
 
 
 /* Function prototypes */
 
-tx_out_t *tx_out_create(uint32_t amount, uint8_t const pub[EC_PUB_LEN]);
+tx_out_t *tx_out_create(uint32_t amount, uint8_t const pub[TX_PUB_LEN]);
 tx_in_t *tx_in_create(unspent_tx_out_t const *unspent);
 uint8_t *transaction_hash(transaction_t const *transaction, uint8_t hash_buf[SHA256_DIGEST_LENGTH]);
-sig_t *tx_in_sign(tx_in_t *in, uint8_t const tx_id[SHA256_DIGEST_LENGTH], EC_KEY const *sender, llist_t *all_unspent);
-transaction_t *transaction_create(EC_KEY const *sender, EC_KEY const *receiver, uint32_t amount, llist_t *all_unspent);
-int transaction_is_valid(transaction_t const *transaction, llist_t *all_unspent);
+sig_t *tx_in_sign(tx_in_t *in, uint8_t const tx_id[SHA256_DIGEST_LENGTH], EC_KEY const *sender, utxo_set_t *all_unspent);
+transaction_t *transaction_create(EC_KEY const *sender, EC_KEY const *receiver, uint32_t amount, utxo_set_t *all_unspent);
+int transaction_is_valid(transaction_t const *transaction, utxo_set_t *all_unspent);
+int transaction_check_inputs(transaction_t const *transaction,
+	utxo_set_t *all_unspent, sig_check_t *checks);
+int64_t sig_checks_run(sig_check_t const *checks, size_t count,
+	unsigned int nb_threads);
+void sig_cache_key(sig_check_t const *check, uint8_t key[SHA256_DIGEST_LENGTH]);
+int sig_cache_contains(uint8_t const key[SHA256_DIGEST_LENGTH]);
+void sig_cache_add(uint8_t const key[SHA256_DIGEST_LENGTH]);
+void sig_cache_stats(sig_cache_stats_t *stats);
+void sig_cache_clear(void);
 transaction_t *coinbase_create(EC_KEY const *receiver, uint32_t block_index);
 int coinbase_is_valid(transaction_t const *coinbase, uint32_t block_index);
 void transaction_destroy(transaction_t *transaction);
-llist_t *update_unspent(llist_t *transactions, uint8_t block_hash[SHA256_DIGEST_LENGTH], llist_t *all_unspent);
+utxo_set_t *update_unspent(llist_t *transactions, uint8_t block_hash[SHA256_DIGEST_LENGTH], utxo_set_t *all_unspent);
+
+/* Unspent output set */
+
+utxo_set_t *utxo_set_create(size_t capacity);
+void utxo_set_destroy(utxo_set_t *set);
+size_t utxo_set_size(utxo_set_t const *set);
+size_t utxo_set_bytes(utxo_set_t const *set);
+int utxo_set_insert(utxo_set_t *set, unspent_tx_out_t const *unspent);
+int utxo_snapshot_save(utxo_set_t const *set,
+	uint8_t const tip[SHA256_DIGEST_LENGTH], uint32_t height, char const *path);
+utxo_set_t *utxo_snapshot_load(char const *path,
+	uint8_t const tip[SHA256_DIGEST_LENGTH], uint32_t height);
+int utxo_set_lookup(utxo_set_t *set,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH],
+	unspent_tx_out_t *unspent);
+int utxo_set_erase(utxo_set_t *set,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH],
+	unspent_tx_out_t *unspent);
+int utxo_set_for_each(utxo_set_t const *set, utxo_func_t action, void *arg);
+utxo_undo_t *utxo_set_apply(utxo_set_t *set, llist_t *transactions,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH]);
+int utxo_set_disconnect(utxo_set_t *set, llist_t *transactions,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH], utxo_undo_t const *undo);
+int utxo_undo_reserve(utxo_set_t *set, llist_t *transactions,
+	utxo_undo_t const *undo, size_t *nb_inputs);
+void utxo_undo_destroy(utxo_undo_t *undo);
+int utxo_set_for_each_owned(utxo_set_t const *set,
+	uint8_t const pub[TX_PUB_LEN], utxo_func_t action, void *arg);
+void utxo_owner_link(utxo_set_t *set, uint32_t i);
+void utxo_owner_unlink(utxo_set_t *set, uint32_t i);
+void utxo_set_remove_slot(utxo_set_t *set, size_t i);
+int utxo_set_reserve(utxo_set_t *set, size_t n);
+utxo_entry_t *utxo_set_place(utxo_set_t *set, size_t i, uint64_t fp,
+	unspent_tx_out_t const *unspent, uint32_t state);
+utxo_entry_t *utxo_set_entry(utxo_set_t const *set, uint32_t i);
+int utxo_entry_reserve(utxo_set_t *set, size_t n);
+uint32_t utxo_entry_alloc(utxo_set_t *set);
+void utxo_entry_free(utxo_set_t *set, uint32_t i);
+int utxo_entry_pack(utxo_set_t *set, utxo_entry_t *entry,
+	unspent_tx_out_t const *unspent);
+void utxo_entry_unpack(utxo_set_t const *set, utxo_entry_t const *entry,
+	unspent_tx_out_t *unspent);
+uint32_t utxo_set_find_tx(utxo_set_t const *set,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH]);
+uint64_t utxo_intern_fp(uint8_t const *key, size_t len);
+uint32_t utxo_intern_find(utxo_intern_t const *t, uint8_t const *key);
+int utxo_intern_reserve(utxo_intern_t *t, size_t n);
+uint32_t utxo_intern_add(utxo_intern_t *t, uint8_t const *key);
+uint32_t utxo_intern_release(utxo_intern_t *t, uint32_t id);
+uint8_t *utxo_intern_key(utxo_intern_t const *t, uint32_t id);
+void utxo_intern_destroy(utxo_intern_t *t);
+int utxo_set_scan_disk(utxo_set_t const *set, uint8_t const *pub,
+	utxo_func_t action, void *arg);
+utxo_set_t *utxo_set_open(char const *path, size_t max_bytes);
+int utxo_set_flush(utxo_set_t *set);
+int utxo_set_checkpoint(utxo_set_t *set);
+int utxo_set_reserve_dirty(utxo_set_t *set, size_t n);
+int utxo_set_mark(utxo_set_t *set, uint32_t i);
+int utxo_set_cached(utxo_set_t const *set,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH]);
+utxo_disk_t *utxo_disk_open(char const *path);
+void utxo_disk_close(utxo_disk_t *disk);
+int utxo_disk_sync(utxo_disk_t *disk);
+int utxo_disk_read(utxo_disk_t const *disk, uint64_t i, utxo_rec_t *rec);
+int utxo_disk_write(utxo_disk_t *disk, uint64_t i, utxo_rec_t const *rec);
+int utxo_disk_get(utxo_disk_t const *disk,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH], unspent_tx_out_t *unspent);
+int utxo_disk_put(utxo_disk_t *disk, unspent_tx_out_t const *unspent);
+int utxo_disk_del(utxo_disk_t *disk,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH]);
+int utxo_disk_scan(utxo_disk_t const *disk, utxo_func_t action, void *arg);
+int utxo_disk_grow(utxo_disk_t *disk);
+int utxo_disk_upgrade(char const *src, char const *dst);
+int utxo_disk_reserve(utxo_disk_t *disk, uint64_t n);
+int utxo_disk_sync_dir(char const *path);
+int utxo_journal_begin(utxo_disk_t *disk);
+void utxo_journal_end(utxo_disk_t *disk, int keep);
+utxo_rec_t *utxo_journal_find(utxo_journal_t const *journal, uint64_t i);
+int utxo_journal_add(utxo_journal_t *journal, uint64_t i,
+	utxo_rec_t const *rec);
+int utxo_journal_commit(utxo_disk_t *disk,
+	uint8_t const tip[SHA256_DIGEST_LENGTH], uint32_t height);
+int utxo_journal_replay(utxo_disk_t *disk);
+uint64_t utxo_set_fp(uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH]);
+size_t utxo_set_probe(utxo_set_t const *set,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH], uint64_t fp);
 
 #endif /* TRANSACTION_H */
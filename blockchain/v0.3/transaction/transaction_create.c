@@ -6,97 +6,128 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
-#define SIG_MAX_LEN 72
+
+/**
+ * select_unspent - Selects an unspent output of the sender as an input
+ * @unspent: Unspent output
+ * @arg: Pointer to the tx_data_t of the transaction being built
+ *
+ * Return: 0 to keep selecting, 1 once enough coins were selected, -1 on
+ * failure
+ */
+static int select_unspent(unspent_tx_out_t const *unspent, void *arg)
+{
+	tx_data_t *data = arg;
+	tx_in_t *input;
+
+	input = tx_in_create(unspent);
+	if (!input || llist_add_node(data->txt->inputs, input, ADD_NODE_REAR) == -1)
+		return (free(input), -1);
+	data->amount_total += unspent->out.amount;
+	return (data->amount_total >= data->needed);
+}
+
+/**
+ * sign_inputs - Signs the inputs of a transaction
+ * @tx: Transaction, its ID computed
+ * @sender: Private key of the sender, owner of every input
+ * @all_unspent: Set of all unspent outputs
+ *
+ * Description: Every input signs the same message, the transaction ID,
+ * with the same key. The first input is signed and the others receive
+ * a copy of its signature.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int sign_inputs(transaction_t *tx, EC_KEY const *sender,
+		       utxo_set_t *all_unspent)
+{
+	sig_t const *first = NULL;
+	tx_in_t *input;
+	int i;
+
+	for (i = 0; i < llist_size(tx->inputs); i++)
+	{
+		input = llist_get_node_at(tx->inputs, i);
+		if (!first)
+		{
+			first = tx_in_sign(input, tx->id, sender, all_unspent);
+			if (!first)
+				return (0);
+			continue;
+		}
+		input->sig = *first;
+	}
+	return (1);
+}
 
 /**
  * transaction_create - Creates a new transaction
  * @sender: sender’s private key
  * @receiver: receiver’s public key
  * @amount: amount to transfer
- * @all_unspent: list of all unspent outputs
+ * @all_unspent: set of all unspent outputs
  *
  * Return: pointer to the created transaction or NULL on failure
  */
 transaction_t *transaction_create(EC_KEY const *sender, EC_KEY const *receiver,
-				  uint32_t amount, llist_t *all_unspent)
+				  uint32_t amount, utxo_set_t *all_unspent)
 {
 	transaction_t *tx;
-	llist_t *inputs, *outputs;
-	uint8_t pub_sender[EC_PUB_LEN], pub_receiver[EC_PUB_LEN];
-	uint32_t total = 0, leftover;
-	int i;
+	tx_data_t data;
+	uint8_t pub_receiver[TX_PUB_LEN];
+	uint32_t leftover;
 	tx_out_t *out_send, *out_change;
-	tx_in_t *input;
-	unspent_tx_out_t *unspent;
 
 	if (!sender || !receiver || !all_unspent)
 		return (NULL);
 
-	ec_to_pub(sender, pub_sender);
-	ec_to_pub(receiver, pub_receiver);
-
-	inputs = llist_create(MT_SUPPORT_FALSE);
-	outputs = llist_create(MT_SUPPORT_FALSE);
-	if (!inputs || !outputs)
+	memset(&data, 0, sizeof(data));
+	if (!ec_to_pub_compressed(sender, data.pub) ||
+	    !ec_to_pub_compressed(receiver, pub_receiver))
 		return (NULL);
 
-	/* Select unspent outputs owned by sender */
-	for (i = 0; i < llist_size(all_unspent) && total < amount; i++)
-	{
-		unspent = llist_get_node_at(all_unspent, i);
-		if (!unspent)
-			continue;
-
-		if (memcmp(unspent->out.pub, pub_sender, EC_PUB_LEN) == 0)
-		{
-			input = tx_in_create(unspent);
-			if (!input || llist_add_node(inputs, input, ADD_NODE_REAR) == -1)
-				goto fail;
-			total += unspent->out.amount;
-		}
-	}
+	/* Allocate transaction */
+	tx = calloc(1, sizeof(*tx));
+	if (!tx)
+		return (NULL);
+	tx->inputs = llist_create(MT_SUPPORT_FALSE);
+	tx->outputs = llist_create(MT_SUPPORT_FALSE);
+	if (!tx->inputs || !tx->outputs)
+		goto fail;
 
-	if (total < amount)
+	/* Select unspent outputs owned by sender, through the owner index */
+	data.needed = amount;
+	data.txt = tx;
+	data.sender = sender;
+	data.all_unspent = all_unspent;
+	if (utxo_set_for_each_owned(all_unspent, data.pub, select_unspent,
+				    &data) == -1 ||
+	    data.amount_total < amount)
 		goto fail;
 
 	/* Output to receiver */
 	out_send = tx_out_create(amount, pub_receiver);
-	if (!out_send || llist_add_node(outputs, out_send, ADD_NODE_REAR) == -1)
+	if (!out_send || llist_add_node(tx->outputs, out_send, ADD_NODE_REAR) == -1)
 		goto fail;
 
 	/* Return change to sender, if needed */
-	leftover = total - amount;
+	leftover = data.amount_total - amount;
 	if (leftover > 0)
 	{
-		out_change = tx_out_create(leftover, pub_sender);
-		if (!out_change || llist_add_node(outputs, out_change, ADD_NODE_REAR) == -1)
+		out_change = tx_out_create(leftover, data.pub);
+		if (!out_change || llist_add_node(tx->outputs, out_change, ADD_NODE_REAR) == -1)
 			goto fail;
 	}
 
-	/* Allocate transaction */
-	tx = calloc(1, sizeof(*tx));
-	if (!tx)
-		goto fail;
-
-	tx->inputs = inputs;
-	tx->outputs = outputs;
 	transaction_hash(tx, tx->id);
 
-	/* Sign each input */
-	for (i = 0; i < llist_size(inputs); i++)
-	{
-		input = llist_get_node_at(inputs, i);
-		if (!tx_in_sign(input, tx->id, sender, all_unspent))
-		{
-			free(tx);
-			goto fail;
-		}
-	}
+	if (!sign_inputs(tx, sender, all_unspent))
+		goto fail;
 
 	return (tx);
 
 fail:
-	llist_destroy(inputs, 1, free);
-	llist_destroy(outputs, 1, free);
+	transaction_destroy(tx);
 	return (NULL);
 }
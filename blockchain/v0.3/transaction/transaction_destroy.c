@@ -3,13 +3,23 @@
 /**
  * transaction_destroy - frees a transaction structure
  * @transaction: pointer to transaction to destroy
+ *
+ * Description: Only the lists of a transaction allocated from the arena
+ * of its block are freed, the arena holds the rest.
  */
 void transaction_destroy(transaction_t *transaction)
 {
+	int owned;
+
 	if (!transaction)
 		return;
 
-	llist_destroy(transaction->inputs, 1, free);
-	llist_destroy(transaction->outputs, 1, free);
-	free(transaction);
+	owned = !transaction->in_arena;
+	if (transaction->inputs)
+		llist_destroy(transaction->inputs,
+			      owned && !transaction->inputs_mapped, free);
+	if (transaction->outputs)
+		llist_destroy(transaction->outputs, owned, free);
+	if (owned)
+		free(transaction);
 }
@@ -2,73 +2,176 @@
 #include "transaction.h"
 
 /**
- * transaction_is_valid - Validates a transaction
+ * struct tx_check_s - State shared by the transaction check callbacks
+ *
+ * @tx:          Transaction being checked
+ * @all_unspent: Set of all unspent outputs
+ * @checks:      Receives one signature check per distinct key and signature
+ * @count:       Number of checks written so far
+ * @input_sum:   Sum of the amounts of the referenced outputs
+ * @output_sum:  Sum of the amounts of the outputs
+ * @failed:      Set when the transaction is invalid
+ */
+typedef struct tx_check_s
+{
+	transaction_t const *tx;
+	utxo_set_t *all_unspent;
+	sig_check_t *checks;
+	int count;
+	uint32_t input_sum;
+	uint32_t output_sum;
+	int failed;
+} tx_check_t;
+
+/**
+ * check_queued - Tells whether a signature check is already queued
+ * @check: Transaction check state
+ * @pub: Public key of the signer
+ * @sig: Signature
+ *
+ * Description: All the inputs of a transaction sign the same message, its
+ * ID, so inputs sharing a key and a signature need a single verification.
+ *
+ * Return: 1 if queued, 0 otherwise
+ */
+static int check_queued(tx_check_t const *check, uint8_t const *pub,
+			sig_t const *sig)
+{
+	sig_check_t const *queued;
+	int i;
+
+	for (i = 0; i < check->count; i++)
+	{
+		queued = check->checks + i;
+		if (queued->sig->len == sig->len &&
+		    memcmp(queued->pub, pub, TX_PUB_LEN) == 0 &&
+		    memcmp(queued->sig->sig, sig->sig, sig->len) == 0)
+			return (1);
+	}
+	return (0);
+}
+
+/**
+ * check_input - Looks up the output referenced by an input and queues the
+ * check of its signature
+ * @node: Pointer to the tx_in_t
+ * @idx: Index of the input
+ * @arg: Pointer to the tx_check_t
+ *
+ * Return: 0 to keep iterating, 1 to stop on failure
+ */
+static int check_input(llist_node_t node, unsigned int idx, void *arg)
+{
+	tx_in_t const *in = node;
+	tx_check_t *check = arg;
+	sig_check_t *queued;
+	unspent_tx_out_t unspent;
+
+	if (!in || !utxo_set_lookup(check->all_unspent, in->block_hash,
+				    in->tx_id, in->tx_out_hash, &unspent))
+		return (check->failed = 1);
+
+	check->input_sum += unspent.out.amount;
+	if (check_queued(check, unspent.out.pub, &in->sig))
+		return (0);
+	queued = check->checks + check->count++;
+	memcpy(queued->pub, unspent.out.pub, TX_PUB_LEN);
+	queued->msg = check->tx->id;
+	queued->sig = &in->sig;
+	queued->index = idx;
+	return (0);
+}
+
+/**
+ * sum_output - Checks the key of an output and adds its amount to the
+ * output sum
+ * @node: Pointer to the tx_out_t
+ * @idx: Index of the output, unused
+ * @arg: Pointer to the tx_check_t
+ *
+ * Return: 0 to keep iterating, 1 to stop on failure
+ */
+static int sum_output(llist_node_t node, unsigned int idx, void *arg)
+{
+	tx_out_t const *out = node;
+	tx_check_t *check = arg;
+
+	(void)idx;
+	if (!out || ec_pub_len(out->pub) != TX_PUB_LEN)
+		return (check->failed = 1);
+	check->output_sum += out->amount;
+	return (0);
+}
+
+/**
+ * transaction_check_inputs - Validates a transaction, signatures aside
  * @transaction: pointer to transaction to validate
- * @all_unspent: list of all unspent outputs in the blockchain
+ * @all_unspent: set of all unspent outputs in the blockchain
+ * @checks: receives the signature checks, in input order, the caller
+ *          sizes it with llist_size(transaction->inputs)
  *
- * Return: 1 if valid, 0 otherwise
+ * Description: The ID, the referenced outputs, the amounts and the form
+ * of the output keys are checked. A transaction without inputs is
+ * rejected, see merkle_level. The signatures are left to the caller, see
+ * sig_checks_run. One check is written per distinct public key and
+ * signature pair.
+ *
+ * Return: Number of checks written, or -1 if the transaction is invalid
  */
-int transaction_is_valid(transaction_t const *transaction, llist_t *all_unspent)
+int transaction_check_inputs(transaction_t const *transaction,
+	utxo_set_t *all_unspent, sig_check_t *checks)
 {
 	uint8_t hash[SHA256_DIGEST_LENGTH];
-	tx_in_t *in;
-	unspent_tx_out_t *unspent;
-	tx_out_t *out;
-	uint32_t input_sum = 0, output_sum = 0;
-	int i, j;
-	EC_KEY *pub_key;
+	tx_check_t check;
 
-	if (!transaction || !all_unspent)
-		return (0);
+	if (!transaction || !all_unspent || !checks ||
+	    llist_size(transaction->inputs) < 1)
+		return (-1);
 
 	/* Verify transaction hash matches */
 	if (!transaction_hash(transaction, hash) ||
 	    memcmp(hash, transaction->id, (size_t)SHA256_DIGEST_LENGTH) != 0)
-		return (0);
+		return (-1);
 
-	/* Validate each input */
-	for (i = 0; i < llist_size(transaction->inputs); i++)
-	{
-		in = llist_get_node_at(transaction->inputs, i);
-		unspent = NULL;
-
-		/* Search referenced unspent output */
-		for (j = 0; j < llist_size(all_unspent); j++)
-		{
-			unspent = llist_get_node_at(all_unspent, j);
-			if (!unspent)
-				continue;
-
-			if (memcmp(in->block_hash, unspent->block_hash, (size_t)SHA256_DIGEST_LENGTH) == 0 &&
-			    memcmp(in->tx_id, unspent->tx_id, (size_t)SHA256_DIGEST_LENGTH) == 0 &&
-			    memcmp(in->tx_out_hash, unspent->out.hash, (size_t)SHA256_DIGEST_LENGTH) == 0)
-				break;
-			unspent = NULL;
-		}
-
-		if (!unspent)
-			return (0);
-
-		/* Verify signature */
-		pub_key = ec_from_pub(unspent->out.pub);
-		if (!pub_key || !ec_verify(pub_key, transaction->id, (size_t)SHA256_DIGEST_LENGTH, &in->sig))
-		{
-			EC_KEY_free(pub_key);
-			return (0);
-		}
-		EC_KEY_free(pub_key);
-
-		input_sum += unspent->out.amount;
-	}
+	memset(&check, 0, sizeof(check));
+	check.tx = transaction;
+	check.all_unspent = all_unspent;
+	check.checks = checks;
 
-	/* Sum all outputs */
-	for (i = 0; i < llist_size(transaction->outputs); i++)
-	{
-		out = llist_get_node_at(transaction->outputs, i);
-		if (!out)
-			return (0);
-		output_sum += out->amount;
-	}
+	/* Look up the referenced outputs, then sum all outputs */
+	llist_for_each(transaction->inputs, check_input, &check);
+	if (!check.failed)
+		llist_for_each(transaction->outputs, sum_output, &check);
+
+	if (check.failed || check.input_sum != check.output_sum)
+		return (-1);
+	return (check.count);
+}
+
+/**
+ * transaction_is_valid - Validates a transaction
+ * @transaction: pointer to transaction to validate
+ * @all_unspent: set of all unspent outputs in the blockchain
+ *
+ * Return: 1 if valid, 0 otherwise
+ */
+int transaction_is_valid(transaction_t const *transaction, utxo_set_t *all_unspent)
+{
+	sig_check_t *checks;
+	int nb_inputs, nb_checks, valid;
+
+	if (!transaction || !all_unspent)
+		return (0);
+
+	nb_inputs = llist_size(transaction->inputs);
+	if (nb_inputs < 0)
+		return (0);
+	checks = malloc((nb_inputs ? nb_inputs : 1) * sizeof(*checks));
+	if (!checks)
+		return (0);
 
-	return (input_sum == output_sum);
+	nb_checks = transaction_check_inputs(transaction, all_unspent, checks);
+	valid = nb_checks >= 0 && sig_checks_run(checks, nb_checks, 1) == -1;
+	free(checks);
+	return (valid);
 }
@@ -6,41 +6,30 @@
  * @in: pointer to the transaction input to sign
  * @tx_id: ID of the transaction containing the input
  * @sender: sender's EC_KEY (private key)
- * @all_unspent: list of all unspent outputs in the blockchain
+ * @all_unspent: set of all unspent outputs in the blockchain
  *
  * Return: pointer to the input's signature or NULL on failure
  */
 sig_t *tx_in_sign(tx_in_t *in, uint8_t const tx_id[SHA256_DIGEST_LENGTH],
-		  EC_KEY const *sender, llist_t *all_unspent)
+		  EC_KEY const *sender, utxo_set_t *all_unspent)
 {
-	unspent_tx_out_t *unspent;
-	uint8_t pub[EC_PUB_LEN];
-	int i;
+	unspent_tx_out_t unspent;
+	uint8_t pub[TX_PUB_LEN];
 
 	if (!in || !tx_id || !sender || !all_unspent)
 		return (NULL);
 
 	/* Find the matching unspent output */
-	for (i = 0; i < llist_size(all_unspent); i++)
-	{
-		unspent = llist_get_node_at(all_unspent, i);
-		if (!unspent)
-			continue;
-
-		if (memcmp(unspent->block_hash, in->block_hash, SHA256_DIGEST_LENGTH) == 0 &&
-		    memcmp(unspent->tx_id, in->tx_id, SHA256_DIGEST_LENGTH) == 0 &&
-		    memcmp(unspent->out.hash, in->tx_out_hash, SHA256_DIGEST_LENGTH) == 0)
-		{
-			ec_to_pub(sender, pub);
-			if (memcmp(pub, unspent->out.pub, EC_PUB_LEN) != 0)
-				return (NULL); /* Sender doesn't match output owner */
+	if (!utxo_set_lookup(all_unspent, in->block_hash, in->tx_id,
+			     in->tx_out_hash, &unspent))
+		return (NULL);
 
-			if (!ec_sign(sender, tx_id, SHA256_DIGEST_LENGTH, &in->sig))
-				return (NULL);
+	if (!ec_to_pub_compressed(sender, pub) ||
+	    memcmp(pub, unspent.out.pub, TX_PUB_LEN) != 0)
+		return (NULL); /* Sender doesn't match output owner */
 
-			return (&in->sig);
-		}
-	}
+	if (!ec_sign(sender, tx_id, SHA256_DIGEST_LENGTH, &in->sig))
+		return (NULL);
 
-	return (NULL);
+	return (&in->sig);
 }
@@ -7,15 +7,15 @@
  * tx_out_create - Creates and initializes a new
  * transaction output
  * @amount: Amount of coins to transfer
- * @pub: Receiver’s public key
+ * @pub: Receiver’s public key, in compressed form
  *
  * Return: Pointer to the created tx_out_t, or NULL on failure
  */
-tx_out_t *tx_out_create(uint32_t amount, uint8_t const pub[EC_PUB_LEN])
+tx_out_t *tx_out_create(uint32_t amount, uint8_t const pub[TX_PUB_LEN])
 {
 	tx_out_t *out;
 
-	if (!pub)
+	if (ec_pub_len(pub) != TX_PUB_LEN)
 		return (NULL);
 
 	out = calloc(1, sizeof(tx_out_t));
@@ -23,10 +23,10 @@ tx_out_t *tx_out_create(uint32_t amount, uint8_t const pub[EC_PUB_LEN])
 		return (NULL);
 
 	out->amount = amount;
-	memcpy(out->pub, pub, EC_PUB_LEN);
+	memcpy(out->pub, pub, TX_PUB_LEN);
 
 	/* Hash the amount + pub key to produce output hash */
-	if (!sha256((int8_t const *)out, sizeof(out->amount) + EC_PUB_LEN, out->hash))
+	if (!sha256((int8_t const *)out, sizeof(out->amount) + TX_PUB_LEN, out->hash))
 	{
 		free(out);
 		return (NULL);
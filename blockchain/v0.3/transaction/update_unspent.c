@@ -4,104 +4,177 @@
 #include <string.h>
 
 /**
- * match_unspent_by_idx - Helper to match unspent output by its index
- * @node_data: Pointer to unspent_tx_out_t
- * @arg: Pointer to uint32_t index to match
+ * struct unspent_update_s - State shared by the update callbacks
  *
- * Return: 1 if matches, 0 otherwise
+ * @set:        Set of unspent outputs being updated
+ * @block_hash: Hash of the block holding the transactions
+ * @tx:         Transaction being applied
+ * @undo:       Receives the outputs spent by the block, sized for all the
+ *              inputs of the block
+ * @failed:     Set when the update cannot proceed
  */
-static int match_unspent_by_idx(void *node_data, void *arg)
+typedef struct unspent_update_s
 {
-	unspent_tx_out_t *uto = node_data;
-	uint32_t idx = *(uint32_t *)arg;
+	utxo_set_t *set;
+	uint8_t const *block_hash;
+	transaction_t const *tx;
+	utxo_undo_t *undo;
+	int failed;
+} unspent_update_t;
 
-	return (uto->out.idx == idx);
+/**
+ * spend_input - Removes the output referenced by an input, recording it
+ * in the undo record
+ * @node: Pointer to the tx_in_t
+ * @idx: Index of the input, unused
+ * @arg: Pointer to the unspent_update_t
+ *
+ * Description: Inputs that reference no unspent output, such as the
+ * coinbase input, are skipped.
+ *
+ * Return: Always 0
+ */
+static int spend_input(llist_node_t node, unsigned int idx, void *arg)
+{
+	tx_in_t const *in = node;
+	unspent_update_t *update = arg;
+	utxo_undo_t *undo = update->undo;
+
+	(void)idx;
+	if (!in || undo->nb_spent == undo->capacity)
+		return (0);
+	if (utxo_set_erase(update->set, in->block_hash, in->tx_id,
+			   in->tx_out_hash, &undo->spent[undo->nb_spent]))
+		undo->nb_spent++;
+	return (0);
+}
+
+/**
+ * add_output - Adds an output of the transaction being applied
+ * @node: Pointer to the tx_out_t
+ * @idx: Index of the output, unused
+ * @arg: Pointer to the unspent_update_t
+ *
+ * Return: 0 to keep iterating, 1 to stop on failure
+ */
+static int add_output(llist_node_t node, unsigned int idx, void *arg)
+{
+	tx_out_t const *out = node;
+	unspent_update_t *update = arg;
+	unspent_tx_out_t unspent;
+
+	(void)idx;
+	if (!out)
+		return (0);
+	memcpy(unspent.block_hash, update->block_hash, SHA256_DIGEST_LENGTH);
+	memcpy(unspent.tx_id, update->tx->id, SHA256_DIGEST_LENGTH);
+	memcpy(&unspent.out, out, sizeof(unspent.out));
+	if (!utxo_set_insert(update->set, &unspent) &&
+	    !utxo_set_lookup(update->set, unspent.block_hash, unspent.tx_id,
+			     unspent.out.hash, NULL))
+		update->failed = 1;
+	return (update->failed);
 }
 
 /**
- * update_unspent - Updates the list of all unspent transaction outputs
+ * apply_transaction - Spends the inputs and adds the outputs of a
+ * transaction
+ * @node: Pointer to the transaction_t
+ * @idx: Index of the transaction, unused
+ * @arg: Pointer to the unspent_update_t
+ *
+ * Return: 0 to keep iterating, 1 to stop on failure
+ */
+static int apply_transaction(llist_node_t node, unsigned int idx, void *arg)
+{
+	unspent_update_t *update = arg;
+
+	(void)idx;
+	if (!node)
+		return (0);
+	update->tx = node;
+	llist_for_each(update->tx->inputs, spend_input, update);
+	if (!update->failed)
+		llist_for_each(update->tx->outputs, add_output, update);
+	return (update->failed);
+}
+
+/**
+ * utxo_set_apply - Applies the transactions of a block to a set of
+ * unspent outputs, in place
+ * @set: Set of unspent outputs
  * @transactions: List of validated transactions from a block
  * @block_hash: Hash of the block that contains these transactions
- * @all_unspent: List of all previously unspent transaction outputs
  *
- * Return: New list of unspent transaction outputs on success, or NULL on failure
+ * Description: Inputs spend the outputs they reference, outputs become
+ * unspent. Transactions are applied in order, so an output may be spent
+ * in the block that creates it. Only the outputs the block spends and
+ * creates are touched. The memory for the block and for its rollback is
+ * reserved first, see utxo_undo_reserve, so that past that point only
+ * the file of a disk-backed set can fail. On failure the changes are
+ * rolled back. Otherwise @block_hash becomes the tip of @set, and a
+ * disk-backed set is checkpointed, a failed flush being retried at the
+ * next block.
+ *
+ * Return: Undo record holding the spent outputs, to pass to
+ * utxo_set_disconnect, or NULL on failure
  */
-llist_t *update_unspent(llist_t *transactions,
-			uint8_t block_hash[SHA256_DIGEST_LENGTH],
-			llist_t *all_unspent)
+utxo_undo_t *utxo_set_apply(utxo_set_t *set, llist_t *transactions,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH])
 {
-	llist_t *new_unspent;
-	transaction_t *tx;
-	tx_out_t *tx_out;
-	tx_in_t *tx_in;
-	unspent_tx_out_t *uto;
-	int i, j, num_tx, num_out, num_in;
+	unspent_update_t update;
+	size_t nb_inputs;
 
-	if (!transactions || !block_hash || !all_unspent)
+	if (!set || !transactions || !block_hash ||
+	    !utxo_undo_reserve(set, transactions, NULL, &nb_inputs))
 		return (NULL);
 
-	new_unspent = llist_create(MT_SUPPORT_TRUE);
-	if (!new_unspent)
-		return (NULL);
-
-	/* Copy all_unspent into new_unspent */
-	for (i = 0; i < (int)llist_size(all_unspent); i++)
-	{
-		unspent_tx_out_t *original = llist_get_node_at(all_unspent, i);
-		if (!original)
-			continue;
-
-		unspent_tx_out_t *copy = malloc(sizeof(*copy));
-		if (!copy)
-			continue;
-
-		memcpy(copy, original, sizeof(*copy));
-		llist_add_node(new_unspent, copy, ADD_NODE_REAR);
-	}
-
-	num_tx = llist_size(transactions);
-
-	for (i = 0; i < num_tx; i++)
+	memset(&update, 0, sizeof(update));
+	update.undo = calloc(1, sizeof(*update.undo));
+	if (update.undo)
+		update.undo->spent = malloc((nb_inputs ? nb_inputs : 1) *
+					    sizeof(*update.undo->spent));
+	if (!update.undo || !update.undo->spent)
+		return (utxo_undo_destroy(update.undo), NULL);
+	update.undo->capacity = (uint32_t)nb_inputs;
+	memcpy(update.undo->prev_tip, set->tip, SHA256_DIGEST_LENGTH);
+	update.undo->prev_height = set->height;
+	update.set = set;
+	update.block_hash = block_hash;
+	llist_for_each(transactions, apply_transaction, &update);
+	if (update.failed)
 	{
-		tx = llist_get_node_at(transactions, i);
-		if (!tx)
-			continue;
-
-		/* Remove inputs from unspent */
-		num_in = llist_size(tx->inputs);
-		for (j = 0; j < num_in; j++)
-		{
-			tx_in = llist_get_node_at(tx->inputs, j);
-			if (!tx_in)
-				continue;
-
-			uint32_t idx_to_remove = tx_in->tx_out_idx;
-			llist_remove_node(new_unspent, match_unspent_by_idx, &idx_to_remove, 1, free);
-		}
-
-		/* Add outputs as new unspent */
-		num_out = llist_size(tx->outputs);
-		for (j = 0; j < num_out; j++)
-		{
-			tx_out = llist_get_node_at(tx->outputs, j);
-			if (!tx_out)
-				continue;
-
-			uto = malloc(sizeof(*uto));
-			if (!uto)
-				continue;
-
-			memcpy(uto->block_hash, block_hash, SHA256_DIGEST_LENGTH);
-			memcpy(uto->tx_id, tx->id, SHA256_DIGEST_LENGTH);
-			memcpy(&uto->out, tx_out, sizeof(tx_out_t));
-			uto->out.idx = j;
-
-			llist_add_node(new_unspent, uto, ADD_NODE_REAR);
-		}
+		utxo_set_disconnect(set, transactions, block_hash, update.undo);
+		utxo_undo_destroy(update.undo);
+		return (NULL);
 	}
+	memcpy(set->tip, block_hash, SHA256_DIGEST_LENGTH);
+	set->height++;
+	utxo_set_checkpoint(set);
+	return (update.undo);
+}
 
-	/* Destroy old unspent list */
-	llist_destroy(all_unspent, 1, free);
+/**
+ * update_unspent - Updates the set of all unspent transaction outputs
+ * @transactions: List of validated transactions from a block
+ * @block_hash: Hash of the block that contains these transactions
+ * @all_unspent: Set of all previously unspent transaction outputs
+ *
+ * Description: @all_unspent is updated in place, see utxo_set_apply. Use
+ * utxo_set_apply directly to keep the undo record of the block.
+ *
+ * Return: @all_unspent once updated, or NULL on failure, in which case
+ * @all_unspent is left unchanged
+ */
+utxo_set_t *update_unspent(llist_t *transactions,
+			   uint8_t block_hash[SHA256_DIGEST_LENGTH],
+			   utxo_set_t *all_unspent)
+{
+	utxo_undo_t *undo;
 
-	return (new_unspent);
+	undo = utxo_set_apply(all_unspent, transactions, block_hash);
+	if (!undo)
+		return (NULL);
+	utxo_undo_destroy(undo);
+	return (all_unspent);
 }
@@ -0,0 +1,74 @@
+#include "transaction.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * utxo_set_open - Opens a set of unspent outputs backed by a file
+ * @path: Path of the file, created if needed
+ * @max_bytes: Memory the cache of the set may use, checked at block
+ *             boundaries
+ *
+ * Description: The set is used like one from utxo_set_create. It caches
+ * the outputs it inserts and erases, which reach the file on
+ * utxo_set_flush, and the outputs it reads from the file on demand. The
+ * file belongs to the set until utxo_set_destroy, which flushes it. The
+ * tip of the set is that of the file, the last one flushed: blocks past
+ * it must be applied again, and a zeroed tip means the file matches no
+ * known block.
+ *
+ * Return: Pointer to the new set, or NULL on failure
+ */
+utxo_set_t *utxo_set_open(char const *path, size_t max_bytes)
+{
+	utxo_set_t *set = utxo_set_create(0);
+
+	if (!set)
+		return (NULL);
+	set->disk = utxo_disk_open(path);
+	if (!set->disk)
+		return (utxo_set_destroy(set), NULL);
+	set->count = set->disk->count;
+	memcpy(set->tip, set->disk->tip, SHA256_DIGEST_LENGTH);
+	set->height = set->disk->height;
+	set->max_bytes = max_bytes;
+	return (set);
+}
+
+/**
+ * utxo_set_reserve_dirty - Makes room in the list of entries to flush
+ * @set: Disk-backed set of unspent outputs
+ * @n: Number of entries
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_set_reserve_dirty(utxo_set_t *set, size_t n)
+{
+	uint32_t *dirty;
+	size_t cap = set->dirty_cap ? set->dirty_cap : 64;
+
+	if (set->nb_dirty + n <= set->dirty_cap)
+		return (1);
+	while (cap < set->nb_dirty + n)
+		cap *= 2;
+	dirty = realloc(set->dirty, cap * sizeof(*dirty));
+	if (!dirty)
+		return (0);
+	set->dirty = dirty;
+	set->dirty_cap = cap;
+	return (1);
+}
+
+/**
+ * utxo_set_mark - Lists an entry of a disk-backed set for the next flush
+ * @set: Disk-backed set of unspent outputs
+ * @i: Index of the entry about to become dirty or a tombstone
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_set_mark(utxo_set_t *set, uint32_t i)
+{
+	if (!utxo_set_reserve_dirty(set, 1))
+		return (0);
+	set->dirty[set->nb_dirty++] = i;
+	return (1);
+}
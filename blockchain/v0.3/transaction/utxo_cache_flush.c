@@ -0,0 +1,149 @@
+#include "transaction.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * utxo_set_evict - Drops clean entries from the cache of a disk-backed set
+ * until it uses at most half of max_bytes
+ * @set: Disk-backed set of unspent outputs, just flushed
+ *
+ * Description: Entries are dropped in slot order, resuming where the last
+ * eviction stopped, so every cached output gets its turn. Trimming below
+ * the limit leaves room for several blocks before the next flush.
+ */
+static void utxo_set_evict(utxo_set_t *set)
+{
+	utxo_entry_t *entry;
+	uint32_t index;
+	size_t seen = 0;
+
+	while (utxo_set_bytes(set) > set->max_bytes / 2 && seen <= set->mask)
+	{
+		index = set->slots[set->evict_pos].entry;
+		entry = index ? utxo_set_entry(set, index - 1) : NULL;
+		if (entry && entry->state == UTXO_ON_DISK)
+		{
+			utxo_owner_unlink(set, index - 1);
+			utxo_set_remove_slot(set, set->evict_pos);
+			utxo_entry_free(set, index - 1);
+			seen = 0;
+			continue;
+		}
+		set->evict_pos = (set->evict_pos + 1) & set->mask;
+		seen++;
+	}
+}
+
+/**
+ * flush_journal - Writes the changes cached by a disk-backed set to the
+ * journal of its file, then commits it
+ * @set: Disk-backed set of unspent outputs
+ *
+ * Description: The file is grown up front for the dirty entries, so that
+ * every write lands in the journal.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int flush_journal(utxo_set_t *set)
+{
+	utxo_entry_t *entry;
+	unspent_tx_out_t u;
+	size_t i, nb_puts = 0;
+	int ok = 1;
+
+	for (i = 0; i < set->nb_dirty; i++)
+		nb_puts += !(utxo_set_entry(set, set->dirty[i])->state &
+			     UTXO_DELETED);
+	if (!utxo_disk_reserve(set->disk, nb_puts) ||
+	    !utxo_journal_begin(set->disk))
+		return (0);
+	for (i = 0; ok && i < set->nb_dirty; i++)
+	{
+		entry = utxo_set_entry(set, set->dirty[i]);
+		utxo_entry_unpack(set, entry, &u);
+		if (!(entry->state & UTXO_DELETED))
+			ok = utxo_disk_put(set->disk, &u);
+		else if (entry->state & UTXO_ON_DISK)
+			ok = utxo_disk_del(set->disk, u.block_hash, u.tx_id,
+					   u.out.hash) >= 0;
+	}
+	if (!ok)
+		return (utxo_journal_end(set->disk, 0), 0);
+	return (utxo_journal_commit(set->disk, set->tip, set->height));
+}
+
+/**
+ * utxo_set_flush - Writes the changes cached by a disk-backed set to its
+ * file
+ * @set: Set of unspent outputs
+ *
+ * Description: Only the entries listed by utxo_set_mark are visited, and
+ * reach the file at once with the tip of the set, see
+ * utxo_journal_commit. Tombstones are then dropped, dirty entries become
+ * clean, and the cache is trimmed. On failure every entry stays listed;
+ * if the journal was committed, the next flush writes it out first.
+ *
+ * Return: 1 on success or for an in-memory set, 0 on failure
+ */
+int utxo_set_flush(utxo_set_t *set)
+{
+	utxo_entry_t *entry;
+	unspent_tx_out_t u;
+	size_t i;
+
+	if (!set || !set->disk)
+		return (!!set);
+	if (set->disk->pending && !utxo_journal_replay(set->disk))
+		return (0);
+	if ((set->nb_dirty || set->disk->height != set->height ||
+	     memcmp(set->disk->tip, set->tip, SHA256_DIGEST_LENGTH)) &&
+	    !flush_journal(set))
+	{
+		/* Once written out, the journal holds the dirty entries */
+		for (i = 0; set->disk->pending && i < set->nb_dirty; i++)
+		{
+			entry = utxo_set_entry(set, set->dirty[i]);
+			if (!(entry->state & UTXO_DELETED))
+				entry->state |= UTXO_ON_DISK;
+		}
+		return (0);
+	}
+	for (i = 0; i < set->nb_dirty; i++)
+	{
+		entry = utxo_set_entry(set, set->dirty[i]);
+		if (!(entry->state & UTXO_DELETED))
+		{
+			entry->state = UTXO_ON_DISK;
+			continue;
+		}
+		utxo_entry_unpack(set, entry, &u);
+		utxo_set_remove_slot(set, utxo_set_probe(set, u.block_hash,
+			u.tx_id, u.out.hash,
+			utxo_set_fp(u.block_hash, u.tx_id, u.out.hash)));
+		utxo_entry_free(set, set->dirty[i]);
+	}
+	free(set->dirty);
+	set->dirty = NULL;
+	set->nb_dirty = set->dirty_cap = 0;
+	utxo_set_evict(set);
+	return (1);
+}
+
+/**
+ * utxo_set_checkpoint - Flushes a disk-backed set whose cache is over its
+ * limit
+ * @set: Set of unspent outputs
+ *
+ * Description: Called by utxo_set_apply and utxo_set_disconnect once a
+ * block is processed, so the changes of whole blocks reach the file
+ * together. Call utxo_set_flush to persist the set at any other point.
+ *
+ * Return: 1 on success, if no flush was needed or for an in-memory set,
+ * 0 on failure
+ */
+int utxo_set_checkpoint(utxo_set_t *set)
+{
+	if (!set || !set->disk || utxo_set_bytes(set) <= set->max_bytes)
+		return (!!set);
+	return (utxo_set_flush(set));
+}
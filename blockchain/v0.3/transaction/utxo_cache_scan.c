@@ -0,0 +1,88 @@
+#include "transaction.h"
+#include <string.h>
+
+/**
+ * struct disk_filter_s - State of a scan of the file of a disk-backed set
+ *
+ * @set:    Set being scanned
+ * @pub:    Owner whose outputs are visited, NULL to visit them all
+ * @action: Function called on each output visited
+ * @arg:    Extra argument passed to @action
+ */
+typedef struct disk_filter_s
+{
+	utxo_set_t const *set;
+	uint8_t const *pub;
+	utxo_func_t action;
+	void *arg;
+} disk_filter_t;
+
+/**
+ * filter_rec - Visits an output of the file unless the set caches its key
+ * @unspent: Output read from the file
+ * @arg: Pointer to the disk_filter_t
+ *
+ * Description: Cached outputs were visited from memory already, and
+ * tombstones hide the outputs erased since the last flush.
+ *
+ * Return: 0 to keep scanning, or the value returned by the action
+ */
+static int filter_rec(unspent_tx_out_t const *unspent, void *arg)
+{
+	disk_filter_t *filter = arg;
+	utxo_set_t const *set = filter->set;
+
+	if (filter->pub && memcmp(unspent->out.pub, filter->pub, TX_PUB_LEN))
+		return (0);
+	if (set->slots[utxo_set_probe(set, unspent->block_hash, unspent->tx_id,
+		unspent->out.hash, utxo_set_fp(unspent->block_hash, unspent->tx_id,
+					       unspent->out.hash))].entry)
+		return (0);
+	return (filter->action(unspent, filter->arg));
+}
+
+/**
+ * utxo_set_scan_disk - Calls a function on each output of a disk-backed
+ * set that is not cached
+ * @set: Disk-backed set of unspent outputs
+ * @pub: Public key of the owner whose outputs are visited, NULL for all
+ * @action: Function to call, the set must not be modified meanwhile
+ * @arg: Extra argument passed to @action
+ *
+ * Return: 0 once every output was visited, the non-zero value returned by
+ * @action, or -1 on failure
+ */
+int utxo_set_scan_disk(utxo_set_t const *set, uint8_t const *pub,
+	utxo_func_t action, void *arg)
+{
+	disk_filter_t filter;
+
+	filter.set = set;
+	filter.pub = pub;
+	filter.action = action;
+	filter.arg = arg;
+	return (utxo_disk_scan(set->disk, filter_rec, &filter));
+}
+
+/**
+ * utxo_set_cached - Tells whether a set holds an unspent output in memory
+ * @set: Set of unspent outputs
+ * @block_hash: Hash of the block holding the output
+ * @tx_id: ID of the transaction holding the output
+ * @tx_out_hash: Hash of the output
+ *
+ * Return: 1 if the output is cached, 0 otherwise
+ */
+int utxo_set_cached(utxo_set_t const *set,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH])
+{
+	uint32_t index;
+
+	if (!set || !block_hash || !tx_id || !tx_out_hash)
+		return (0);
+	index = set->slots[utxo_set_probe(set, block_hash, tx_id, tx_out_hash,
+		utxo_set_fp(block_hash, tx_id, tx_out_hash))].entry;
+	return (index && !(utxo_set_entry(set, index - 1)->state & UTXO_DELETED));
+}
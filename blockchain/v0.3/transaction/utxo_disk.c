@@ -0,0 +1,130 @@
+#include "transaction.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/**
+ * utxo_disk_sync - Writes the header of a disk-backed table and syncs
+ * its file
+ * @disk: Table
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_disk_sync(utxo_disk_t *disk)
+{
+	uint8_t header[UTXO_DISK_HEADER] = "HBLD" UTXO_DISK_VERSION;
+
+	header[7] = _get_endianness();
+	memcpy(header + 8, &disk->nb_slots, sizeof(disk->nb_slots));
+	memcpy(header + 16, &disk->count, sizeof(disk->count));
+	memcpy(header + 24, disk->tip, SHA256_DIGEST_LENGTH);
+	memcpy(header + 56, &disk->height, sizeof(disk->height));
+	return (pwrite(disk->fd, header, sizeof(header), 0) == sizeof(header) &&
+		fdatasync(disk->fd) == 0);
+}
+
+/**
+ * utxo_disk_open - Opens the file of a disk-backed table, creating it if
+ * needed
+ * @path: Path of the file
+ *
+ * Description: A journal left by a flush cut short is written out first,
+ * see utxo_journal_commit. The journal of an earlier file of the same path
+ * is removed along with it.
+ *
+ * Return: Pointer to the table, or NULL on failure
+ */
+utxo_disk_t *utxo_disk_open(char const *path)
+{
+	uint8_t header[UTXO_DISK_HEADER];
+	char journal[PATH_MAX];
+	utxo_disk_t *disk;
+	struct stat st;
+
+	disk = path ? calloc(1, sizeof(*disk)) : NULL;
+	if (!disk)
+		return (NULL);
+	disk->path = strdup(path);
+	disk->fd = open(path, O_RDWR | O_CREAT, 0600);
+	if (!disk->path || disk->fd < 0 || fstat(disk->fd, &st) == -1)
+		return (utxo_disk_close(disk), NULL);
+	if (st.st_size == 0)
+	{
+		if (snprintf(journal, sizeof(journal), "%s.journal", path) <
+		    (int)sizeof(journal))
+			unlink(journal);
+		disk->nb_slots = UTXO_DISK_SLOTS;
+		if (ftruncate(disk->fd, UTXO_DISK_HEADER + (off_t)disk->nb_slots *
+			      sizeof(utxo_rec_t)) == -1 || !utxo_disk_sync(disk))
+			return (utxo_disk_close(disk), NULL);
+		return (disk);
+	}
+	if (pread(disk->fd, header, sizeof(header), 0) != sizeof(header) ||
+	    memcmp(header, "HBLD" UTXO_DISK_VERSION, 7) != 0 ||
+	    header[7] != _get_endianness())
+		return (utxo_disk_close(disk), NULL);
+	memcpy(&disk->nb_slots, header + 8, sizeof(disk->nb_slots));
+	memcpy(&disk->count, header + 16, sizeof(disk->count));
+	memcpy(disk->tip, header + 24, SHA256_DIGEST_LENGTH);
+	memcpy(&disk->height, header + 56, sizeof(disk->height));
+	if (!disk->nb_slots || (disk->nb_slots & (disk->nb_slots - 1)) ||
+	    (uint64_t)st.st_size < UTXO_DISK_HEADER + disk->nb_slots *
+	    sizeof(utxo_rec_t) || !utxo_journal_replay(disk))
+		return (utxo_disk_close(disk), NULL);
+	return (disk);
+}
+
+/**
+ * utxo_disk_close - Closes a disk-backed table, without syncing it
+ * @disk: Table
+ */
+void utxo_disk_close(utxo_disk_t *disk)
+{
+	if (!disk)
+		return;
+	if (disk->journal)
+		utxo_journal_end(disk, 0);
+	if (disk->fd >= 0)
+		close(disk->fd);
+	free(disk->path);
+	free(disk);
+}
+
+/**
+ * utxo_disk_read - Reads a slot of a disk-backed table
+ * @disk: Table
+ * @i: Index of the slot
+ * @rec: Receives the slot, from the journal if it was written there
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_disk_read(utxo_disk_t const *disk, uint64_t i, utxo_rec_t *rec)
+{
+	utxo_rec_t const *image;
+
+	image = disk->journal ? utxo_journal_find(disk->journal, i) : NULL;
+	if (image)
+		return (*rec = *image, 1);
+	return (pread(disk->fd, rec, sizeof(*rec), UTXO_DISK_HEADER +
+		      (off_t)i * sizeof(*rec)) == sizeof(*rec));
+}
+
+/**
+ * utxo_disk_write - Writes a slot of a disk-backed table
+ * @disk: Table
+ * @i: Index of the slot
+ * @rec: Slot to write, to the journal if there is one
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_disk_write(utxo_disk_t *disk, uint64_t i, utxo_rec_t const *rec)
+{
+	if (disk->journal)
+		return (utxo_journal_add(disk->journal, i, rec));
+	return (pwrite(disk->fd, rec, sizeof(*rec), UTXO_DISK_HEADER +
+		       (off_t)i * sizeof(*rec)) == sizeof(*rec));
+}
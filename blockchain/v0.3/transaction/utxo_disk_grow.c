@@ -0,0 +1,141 @@
+#include "transaction.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/**
+ * struct disk_grow_s - State of the copy of a table into a larger one
+ *
+ * @to:     Larger table
+ * @failed: Set when a write fails
+ */
+typedef struct disk_grow_s
+{
+	utxo_disk_t *to;
+	int failed;
+} disk_grow_t;
+
+/**
+ * copy_rec - Inserts an output in the larger table
+ * @unspent: Output of the smaller table
+ * @arg: Pointer to the disk_grow_t
+ *
+ * Description: Keys are unique, the first free slot of the probe sequence
+ * is taken without comparing keys.
+ *
+ * Return: 0 to keep copying, 1 to stop on failure
+ */
+static int copy_rec(unspent_tx_out_t const *unspent, void *arg)
+{
+	disk_grow_t *grow = arg;
+	utxo_rec_t rec, slot;
+	uint64_t i, mask = grow->to->nb_slots - 1;
+
+	rec.fp = utxo_set_fp(unspent->block_hash, unspent->tx_id,
+			     unspent->out.hash);
+	rec.used = 1;
+	rec.utxo = *unspent;
+	for (i = rec.fp & mask; ; i = (i + 1) & mask)
+	{
+		if (!utxo_disk_read(grow->to, i, &slot))
+			return (grow->failed = 1);
+		if (!slot.used)
+			break;
+	}
+	if (!utxo_disk_write(grow->to, i, &rec))
+		return (grow->failed = 1);
+	grow->to->count++;
+	return (0);
+}
+
+/**
+ * utxo_disk_grow - Doubles the number of slots of a disk-backed table
+ * @disk: Table
+ *
+ * Description: The records are copied into a temporary file, renamed
+ * over the table once synced. The records do not change, so the tip is
+ * kept. A table with a journal cannot grow, its file is not up to date.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_disk_grow(utxo_disk_t *disk)
+{
+	utxo_disk_t to;
+	disk_grow_t grow;
+	char tmp[PATH_MAX];
+
+	if (disk->journal || snprintf(tmp, sizeof(tmp), "%s.tmp",
+				      disk->path) >= (int)sizeof(tmp))
+		return (0);
+	to.fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (to.fd < 0)
+		return (0);
+	to.path = tmp;
+	to.nb_slots = disk->nb_slots * 2;
+	to.count = 0;
+	memcpy(to.tip, disk->tip, SHA256_DIGEST_LENGTH);
+	to.height = disk->height;
+	to.journal = NULL;
+	grow.to = &to;
+	grow.failed = ftruncate(to.fd, UTXO_DISK_HEADER + (off_t)to.nb_slots *
+				sizeof(utxo_rec_t)) == -1;
+	if (!grow.failed)
+		utxo_disk_scan(disk, copy_rec, &grow);
+	if (grow.failed || to.count != disk->count || !utxo_disk_sync(&to) ||
+	    rename(tmp, disk->path) == -1)
+		return (close(to.fd), unlink(tmp), 0);
+	close(disk->fd);
+	disk->fd = to.fd;
+	disk->nb_slots = to.nb_slots;
+	return (utxo_disk_sync_dir(disk->path));
+}
+
+/**
+ * utxo_disk_reserve - Grows a disk-backed table ahead of new outputs
+ * @disk: Table
+ * @n: Number of outputs that may be added
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_disk_reserve(utxo_disk_t *disk, uint64_t n)
+{
+	while ((disk->count + n) * 2 > disk->nb_slots)
+	{
+		if (!utxo_disk_grow(disk))
+			return (0);
+	}
+	return (1);
+}
+
+/**
+ * utxo_disk_sync_dir - Syncs the directory holding a file, so that a
+ * rename or removal of the file is durable
+ * @path: Path of the file
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_disk_sync_dir(char const *path)
+{
+	char dir[PATH_MAX];
+	char *slash;
+	int fd, ok;
+
+	if (snprintf(dir, sizeof(dir), "%s", path) >= (int)sizeof(dir))
+		return (0);
+	slash = strrchr(dir, '/');
+	if (!slash)
+		strcpy(dir, ".");
+	else if (slash == dir)
+		dir[1] = '\0';
+	else
+		*slash = '\0';
+	fd = open(dir, O_RDONLY | O_DIRECTORY);
+	if (fd < 0)
+		return (0);
+	ok = fsync(fd) == 0;
+	close(fd);
+	return (ok);
+}
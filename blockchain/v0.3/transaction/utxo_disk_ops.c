@@ -0,0 +1,190 @@
+#include "transaction.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * disk_probe - Finds the slot of an unspent output key in a disk-backed
+ * table
+ * @disk: Table
+ * @block_hash: Hash of the block holding the output
+ * @tx_id: ID of the transaction holding the output
+ * @tx_out_hash: Hash of the output
+ * @rec: Receives the slot found
+ *
+ * Description: The probe sequence is read UTXO_DISK_PROBE records at a
+ * time, the slots written to the journal taking precedence.
+ *
+ * Return: Index of the slot holding the key, or of the empty slot where it
+ * would be inserted, UINT64_MAX on failure
+ */
+static uint64_t disk_probe(utxo_disk_t const *disk,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH], utxo_rec_t *rec)
+{
+	uint64_t fp = utxo_set_fp(block_hash, tx_id, tx_out_hash), i, j, nb;
+	uint64_t mask = disk->nb_slots - 1;
+	utxo_rec_t recs[UTXO_DISK_PROBE];
+	utxo_rec_t const *image;
+
+	for (i = fp & mask; ; i = (i + nb) & mask)
+	{
+		nb = disk->nb_slots - i < UTXO_DISK_PROBE ?
+			disk->nb_slots - i : UTXO_DISK_PROBE;
+		if (pread(disk->fd, recs, nb * sizeof(*recs), UTXO_DISK_HEADER +
+			  (off_t)i * sizeof(*recs)) !=
+		    (ssize_t)(nb * sizeof(*recs)))
+			return (UINT64_MAX);
+		for (j = 0; j < nb; j++)
+		{
+			image = disk->journal ?
+				utxo_journal_find(disk->journal, i + j) : NULL;
+			*rec = image ? *image : recs[j];
+			if (!rec->used || (rec->fp == fp &&
+			    !memcmp(rec->utxo.out.hash, tx_out_hash,
+				    SHA256_DIGEST_LENGTH) &&
+			    !memcmp(rec->utxo.tx_id, tx_id,
+				    SHA256_DIGEST_LENGTH) &&
+			    !memcmp(rec->utxo.block_hash, block_hash,
+				    SHA256_DIGEST_LENGTH)))
+				return (i + j);
+		}
+	}
+}
+
+/**
+ * utxo_disk_get - Finds an unspent output in a disk-backed table
+ * @disk: Table
+ * @block_hash: Hash of the block holding the output
+ * @tx_id: ID of the transaction holding the output
+ * @tx_out_hash: Hash of the output
+ * @unspent: Receives a copy of the output if found, may be NULL
+ *
+ * Return: 1 if found, 0 if not, -1 on failure
+ */
+int utxo_disk_get(utxo_disk_t const *disk,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH], unspent_tx_out_t *unspent)
+{
+	utxo_rec_t rec;
+
+	if (disk_probe(disk, block_hash, tx_id, tx_out_hash, &rec) == UINT64_MAX)
+		return (-1);
+	if (!rec.used)
+		return (0);
+	if (unspent)
+		*unspent = rec.utxo;
+	return (1);
+}
+
+/**
+ * utxo_disk_put - Writes an unspent output to a disk-backed table,
+ * replacing the record of the same key
+ * @disk: Table
+ * @unspent: Output to write
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_disk_put(utxo_disk_t *disk, unspent_tx_out_t const *unspent)
+{
+	utxo_rec_t rec;
+	uint64_t i;
+
+	if ((disk->count + 1) * 2 > disk->nb_slots && !utxo_disk_grow(disk))
+		return (0);
+	i = disk_probe(disk, unspent->block_hash, unspent->tx_id,
+		       unspent->out.hash, &rec);
+	if (i == UINT64_MAX)
+		return (0);
+	if (!rec.used)
+		disk->count++;
+	rec.fp = utxo_set_fp(unspent->block_hash, unspent->tx_id,
+			     unspent->out.hash);
+	rec.used = 1;
+	rec.utxo = *unspent;
+	return (utxo_disk_write(disk, i, &rec));
+}
+
+/**
+ * utxo_disk_del - Removes an unspent output from a disk-backed table
+ * @disk: Table
+ * @block_hash: Hash of the block holding the output
+ * @tx_id: ID of the transaction holding the output
+ * @tx_out_hash: Hash of the output
+ *
+ * Description: The records following the removed one in its probe
+ * sequence are shifted back.
+ *
+ * Return: 1 if removed, 0 if not found, -1 on failure
+ */
+int utxo_disk_del(utxo_disk_t *disk,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH])
+{
+	uint64_t i, j, home, mask = disk->nb_slots - 1;
+	utxo_rec_t rec;
+
+	i = disk_probe(disk, block_hash, tx_id, tx_out_hash, &rec);
+	if (i == UINT64_MAX)
+		return (-1);
+	if (!rec.used)
+		return (0);
+	for (j = (i + 1) & mask; ; j = (j + 1) & mask)
+	{
+		if (!utxo_disk_read(disk, j, &rec))
+			return (-1);
+		if (!rec.used)
+			break;
+		home = rec.fp & mask;
+		if (((j - home) & mask) >= ((j - i) & mask))
+		{
+			if (!utxo_disk_write(disk, i, &rec))
+				return (-1);
+			i = j;
+		}
+	}
+	memset(&rec, 0, sizeof(rec));
+	if (!utxo_disk_write(disk, i, &rec))
+		return (-1);
+	disk->count--;
+	return (1);
+}
+
+/**
+ * utxo_disk_scan - Calls a function on each output of a disk-backed table
+ * @disk: Table
+ * @action: Function to call, the table must not be modified meanwhile
+ * @arg: Extra argument passed to @action
+ *
+ * Description: The file is read sequentially, UTXO_DISK_SCAN records at a
+ * time.
+ *
+ * Return: 0 once every output was visited, the non-zero value returned by
+ * @action, or -1 on failure
+ */
+int utxo_disk_scan(utxo_disk_t const *disk, utxo_func_t action, void *arg)
+{
+	utxo_rec_t *recs;
+	uint64_t i, j, nb;
+	int ret = 0;
+
+	recs = malloc(UTXO_DISK_SCAN * sizeof(*recs));
+	if (!recs)
+		return (-1);
+	for (i = 0; !ret && i < disk->nb_slots; i += nb)
+	{
+		nb = disk->nb_slots - i < UTXO_DISK_SCAN ?
+			disk->nb_slots - i : UTXO_DISK_SCAN;
+		if (pread(disk->fd, recs, nb * sizeof(*recs), UTXO_DISK_HEADER +
+			  (off_t)i * sizeof(*recs)) != (ssize_t)(nb * sizeof(*recs)))
+			ret = -1;
+		for (j = 0; !ret && j < nb; j++)
+			if (recs[j].used)
+				ret = action(&recs[j].utxo, arg);
+	}
+	free(recs);
+	return (ret);
+}
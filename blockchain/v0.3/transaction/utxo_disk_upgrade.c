@@ -0,0 +1,88 @@
+#include "transaction.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/**
+ * disk_upgrade_rec - Converts a record of a disk-backed set of version 0.3
+ * @p: Record, UTXO_DISK_V03_REC bytes: fingerprint, used flag, block
+ *     hash, transaction ID, then the output with its uncompressed key
+ * @unspent: Receives the output, its key compressed
+ *
+ * Return: 1 on success, 0 if the key is not a valid point
+ */
+static int disk_upgrade_rec(uint8_t const *p, unspent_tx_out_t *unspent)
+{
+	uint8_t const *out = p + 16 + 2 * SHA256_DIGEST_LENGTH;
+
+	memset(unspent, 0, sizeof(*unspent));
+	memcpy(unspent->block_hash, p + 16, SHA256_DIGEST_LENGTH);
+	memcpy(unspent->tx_id, p + 16 + SHA256_DIGEST_LENGTH,
+	       SHA256_DIGEST_LENGTH);
+	memcpy(&unspent->out.amount, out, sizeof(unspent->out.amount));
+	memcpy(unspent->out.hash, out + sizeof(unspent->out.amount) +
+	       EC_PUB_LEN, SHA256_DIGEST_LENGTH);
+	return (ec_pub_compress(out + sizeof(unspent->out.amount),
+				unspent->out.pub) != NULL);
+}
+
+/**
+ * utxo_disk_upgrade - Converts the file of a disk-backed set of version
+ * 0.3 to the current version
+ * @src: Path of the 0.3 file
+ * @dst: Path of the file to write, replaced
+ *
+ * Description: The records are read in order and inserted in a new
+ * table, their keys compressed as by blockchain_upgrade. A 0.3 file
+ * records no tip, the new one has a zeroed tip: the set must be checked
+ * against the chain before use. @dst is removed on failure.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_disk_upgrade(char const *src, char const *dst)
+{
+	uint8_t header[UTXO_DISK_HEADER], *recs;
+	unspent_tx_out_t unspent;
+	utxo_disk_t *disk = NULL;
+	uint64_t nb_slots = 0, count = 0, i, j, nb, used;
+	uint8_t const *rec;
+	int fd, ok;
+
+	fd = src && dst ? open(src, O_RDONLY) : -1;
+	if (fd < 0)
+		return (0);
+	recs = malloc(UTXO_DISK_SCAN * UTXO_DISK_V03_REC);
+	ok = recs && pread(fd, header, sizeof(header), 0) == sizeof(header) &&
+		!memcmp(header, "HBLD0.3", 7) && header[7] == _get_endianness();
+	if (ok)
+	{
+		memcpy(&nb_slots, header + 8, sizeof(nb_slots));
+		memcpy(&count, header + 16, sizeof(count));
+		unlink(dst);
+		disk = utxo_disk_open(dst);
+		ok = disk != NULL;
+	}
+	for (i = 0; ok && i < nb_slots; i += nb)
+	{
+		nb = nb_slots - i < UTXO_DISK_SCAN ?
+			nb_slots - i : UTXO_DISK_SCAN;
+		ok = pread(fd, recs, nb * UTXO_DISK_V03_REC, UTXO_DISK_HEADER +
+			   (off_t)i * UTXO_DISK_V03_REC) ==
+			(ssize_t)(nb * UTXO_DISK_V03_REC);
+		for (j = 0; ok && j < nb; j++)
+		{
+			rec = recs + j * UTXO_DISK_V03_REC;
+			memcpy(&used, rec + 8, sizeof(used));
+			ok = !used || (disk_upgrade_rec(rec, &unspent) &&
+				       utxo_disk_put(disk, &unspent));
+		}
+	}
+	ok = ok && disk->count == count && utxo_disk_sync(disk);
+	close(fd);
+	free(recs);
+	utxo_disk_close(disk);
+	if (!ok && disk)
+		unlink(dst);
+	return (ok);
+}
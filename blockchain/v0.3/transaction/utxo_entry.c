@@ -0,0 +1,106 @@
+#include "transaction.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * utxo_set_entry - Gets an entry of a set by index
+ * @set: Set of unspent outputs
+ * @i: Index of the entry
+ *
+ * Return: Pointer to the entry, stable until the entry is freed
+ */
+utxo_entry_t *utxo_set_entry(utxo_set_t const *set, uint32_t i)
+{
+	return (&set->chunks[i / UTXO_CHUNK][i % UTXO_CHUNK]);
+}
+
+/**
+ * entry_chunk - Allocates a chunk of UTXO_CHUNK free entries
+ * @set: Set of unspent outputs
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int entry_chunk(utxo_set_t *set)
+{
+	utxo_entry_t **chunks, *chunk;
+	uint32_t i;
+
+	chunks = realloc(set->chunks, (set->nb_chunks + 1) * sizeof(*chunks));
+	if (!chunks)
+		return (0);
+	set->chunks = chunks;
+	chunk = malloc(UTXO_CHUNK * sizeof(*chunk));
+	if (!chunk)
+		return (0);
+	chunks[set->nb_chunks] = chunk;
+	for (i = UTXO_CHUNK; i--;)
+	{
+		chunk[i].owner_next = set->free_entry;
+		set->free_entry = set->nb_chunks * UTXO_CHUNK + i;
+	}
+	set->nb_chunks++;
+	return (1);
+}
+
+/**
+ * utxo_entry_reserve - Makes sure a set has free entries
+ * @set: Set of unspent outputs
+ * @n: Number of free entries wanted
+ *
+ * Description: Every entry in use is in the table, so the entries of the
+ * chunks past set->nb_entries are free.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_entry_reserve(utxo_set_t *set, size_t n)
+{
+	while ((size_t)set->nb_chunks * UTXO_CHUNK < set->nb_entries + n)
+	{
+		if (!entry_chunk(set))
+			return (0);
+	}
+	return (1);
+}
+
+/**
+ * utxo_entry_alloc - Takes a free entry of a set
+ * @set: Set of unspent outputs
+ *
+ * Description: A chunk of UTXO_CHUNK entries is allocated when none is
+ * free.
+ *
+ * Return: Index of the entry, or UTXO_NONE on failure
+ */
+uint32_t utxo_entry_alloc(utxo_set_t *set)
+{
+	uint32_t i;
+
+	if (set->free_entry == UTXO_NONE && !entry_chunk(set))
+		return (UTXO_NONE);
+	i = set->free_entry;
+	set->free_entry = utxo_set_entry(set, i)->owner_next;
+	return (i);
+}
+
+/**
+ * utxo_set_find_tx - Finds the interned ID of a transaction of a set
+ * @set: Set of unspent outputs
+ * @block_hash: Hash of the block holding the transaction
+ * @tx_id: ID of the transaction
+ *
+ * Return: ID in the transaction table of @set, or UTXO_NONE if no output
+ * of the transaction is in @set
+ */
+uint32_t utxo_set_find_tx(utxo_set_t const *set,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH])
+{
+	uint8_t tx_key[UTXO_TX_KEY];
+	uint32_t block = utxo_intern_find(&set->blocks, block_hash);
+
+	if (block == UTXO_NONE)
+		return (UTXO_NONE);
+	memcpy(tx_key, tx_id, SHA256_DIGEST_LENGTH);
+	memcpy(tx_key + SHA256_DIGEST_LENGTH, &block, sizeof(block));
+	return (utxo_intern_find(&set->txs, tx_key));
+}
@@ -0,0 +1,96 @@
+#include "transaction.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * release_tx - Drops a reference on an interned transaction, and on its
+ * block once the transaction is released
+ * @set: Set of unspent outputs
+ * @tx: ID of the transaction
+ */
+static void release_tx(utxo_set_t *set, uint32_t tx)
+{
+	uint32_t block;
+
+	memcpy(&block, utxo_intern_key(&set->txs, tx) + SHA256_DIGEST_LENGTH,
+	       sizeof(block));
+	if (!utxo_intern_release(&set->txs, tx))
+		utxo_intern_release(&set->blocks, block);
+}
+
+/**
+ * utxo_entry_pack - Fills an entry of a set from an unspent output
+ * @set: Set of unspent outputs
+ * @entry: Entry to fill, its links and state are left alone
+ * @unspent: Unspent output
+ *
+ * Description: The block hash, transaction ID and public key of @unspent
+ * are interned. A transaction holds one reference on its block, an entry
+ * one on its transaction and one on its key.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_entry_pack(utxo_set_t *set, utxo_entry_t *entry,
+	unspent_tx_out_t const *unspent)
+{
+	uint8_t tx_key[UTXO_TX_KEY];
+	uint32_t block;
+
+	block = utxo_intern_add(&set->blocks, unspent->block_hash);
+	if (block == UTXO_NONE)
+		return (0);
+	memcpy(tx_key, unspent->tx_id, SHA256_DIGEST_LENGTH);
+	memcpy(tx_key + SHA256_DIGEST_LENGTH, &block, sizeof(block));
+	entry->tx = utxo_intern_add(&set->txs, tx_key);
+	if (entry->tx == UTXO_NONE)
+		return (utxo_intern_release(&set->blocks, block), 0);
+	if (set->txs.refs[entry->tx] > 1)
+		utxo_intern_release(&set->blocks, block);
+	entry->key = utxo_intern_add(&set->keys, unspent->out.pub);
+	if (entry->key == UTXO_NONE)
+		return (release_tx(set, entry->tx), 0);
+	memcpy(entry->out_hash, unspent->out.hash, SHA256_DIGEST_LENGTH);
+	entry->amount = unspent->out.amount;
+	return (1);
+}
+
+/**
+ * utxo_entry_unpack - Rebuilds the unspent output of an entry of a set
+ * @set: Set of unspent outputs
+ * @entry: Entry
+ * @unspent: Receives the unspent output
+ */
+void utxo_entry_unpack(utxo_set_t const *set, utxo_entry_t const *entry,
+	unspent_tx_out_t *unspent)
+{
+	uint8_t const *tx_key = utxo_intern_key(&set->txs, entry->tx);
+	uint32_t block;
+
+	memcpy(&block, tx_key + SHA256_DIGEST_LENGTH, sizeof(block));
+	memset(unspent, 0, sizeof(*unspent));
+	memcpy(unspent->block_hash, utxo_intern_key(&set->blocks, block),
+	       SHA256_DIGEST_LENGTH);
+	memcpy(unspent->tx_id, tx_key, SHA256_DIGEST_LENGTH);
+	unspent->out.amount = entry->amount;
+	memcpy(unspent->out.pub, utxo_intern_key(&set->keys, entry->key),
+	       TX_PUB_LEN);
+	memcpy(unspent->out.hash, entry->out_hash, SHA256_DIGEST_LENGTH);
+}
+
+/**
+ * utxo_entry_free - Returns an entry of a set to its free list
+ * @set: Set of unspent outputs
+ * @i: Index of the entry, removed from the table and its owner's chain
+ *
+ * Description: The references of the entry on its transaction and key
+ * are dropped.
+ */
+void utxo_entry_free(utxo_set_t *set, uint32_t i)
+{
+	utxo_entry_t *entry = utxo_set_entry(set, i);
+
+	release_tx(set, entry->tx);
+	utxo_intern_release(&set->keys, entry->key);
+	entry->owner_next = set->free_entry;
+	set->free_entry = i;
+}
@@ -0,0 +1,163 @@
+#include "transaction.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * utxo_intern_fp - Computes the fingerprint of an interned key
+ * @key: Key
+ * @len: Length of @key, at least 8 bytes
+ *
+ * Description: Keys are digests or public keys, whose last bytes are
+ * uniform enough once mixed.
+ *
+ * Return: 64-bit fingerprint, its low bits select the home slot
+ */
+uint64_t utxo_intern_fp(uint8_t const *key, size_t len)
+{
+	uint64_t x;
+
+	memcpy(&x, key + len - sizeof(x), sizeof(x));
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return (x);
+}
+
+/**
+ * intern_grow - Doubles the number of slots of an intern table
+ * @t: Table
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int intern_grow(utxo_intern_t *t)
+{
+	uint32_t nb_slots = t->slots ? (t->mask + 1) * 2 : 16, id, i;
+	uint32_t *slots;
+
+	slots = calloc(nb_slots, sizeof(*slots));
+	if (!slots)
+		return (0);
+	free(t->slots);
+	t->slots = slots;
+	t->mask = nb_slots - 1;
+	for (id = 0; id < t->nb_ids; id++)
+	{
+		if (!t->refs[id])
+			continue;
+		for (i = utxo_intern_fp(utxo_intern_key(t, id), t->key_len) & t->mask;
+		     t->slots[i]; i = (i + 1) & t->mask)
+			;
+		t->slots[i] = id + 1;
+	}
+	return (1);
+}
+
+/**
+ * intern_extend - Doubles the number of IDs allocated for an intern table
+ * @t: Table
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int intern_extend(utxo_intern_t *t)
+{
+	uint32_t cap = t->cap ? t->cap * 2 : 64;
+	uint8_t *keys;
+	uint32_t *refs, *vals;
+
+	keys = realloc(t->keys, (size_t)cap * t->key_len);
+	if (!keys)
+		return (0);
+	t->keys = keys;
+	refs = realloc(t->refs, (size_t)cap * sizeof(*refs));
+	if (!refs)
+		return (0);
+	t->refs = refs;
+	vals = realloc(t->vals, (size_t)cap * sizeof(*vals));
+	if (!vals)
+		return (0);
+	t->vals = vals;
+	t->cap = cap;
+	return (1);
+}
+
+/**
+ * utxo_intern_find - Finds the ID of a key in an intern table
+ * @t: Table
+ * @key: Key of t->key_len bytes
+ *
+ * Return: ID of @key, or UTXO_NONE if it is not interned
+ */
+uint32_t utxo_intern_find(utxo_intern_t const *t, uint8_t const *key)
+{
+	uint32_t i, id;
+
+	if (!t->slots)
+		return (UTXO_NONE);
+	for (i = utxo_intern_fp(key, t->key_len) & t->mask; (id = t->slots[i]);
+	     i = (i + 1) & t->mask)
+	{
+		if (!memcmp(utxo_intern_key(t, id - 1), key, t->key_len))
+			return (id - 1);
+	}
+	return (UTXO_NONE);
+}
+
+/**
+ * utxo_intern_reserve - Makes room for new keys in an intern table
+ * @t: Table
+ * @n: Number of keys
+ *
+ * Description: Interning the next @n new keys does not allocate.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_intern_reserve(utxo_intern_t *t, size_t n)
+{
+	while (!t->slots || (t->count + n) * 2 > (size_t)t->mask + 1)
+	{
+		if (!intern_grow(t))
+			return (0);
+	}
+	while (t->cap - t->count < n)
+	{
+		if (!intern_extend(t))
+			return (0);
+	}
+	return (1);
+}
+
+/**
+ * utxo_intern_add - Takes a reference on a key of an intern table,
+ * interning it if needed
+ * @t: Table
+ * @key: Key of t->key_len bytes
+ *
+ * Description: A new ID is valued UTXO_NONE.
+ *
+ * Return: ID of @key, or UTXO_NONE on failure
+ */
+uint32_t utxo_intern_add(utxo_intern_t *t, uint8_t const *key)
+{
+	uint32_t id = utxo_intern_find(t, key), i;
+
+	if (id != UTXO_NONE)
+		return (t->refs[id]++, id);
+	if (!utxo_intern_reserve(t, 1))
+		return (UTXO_NONE);
+	if (t->free_id != UTXO_NONE)
+	{
+		id = t->free_id;
+		t->free_id = t->vals[id];
+	}
+	else
+		id = t->nb_ids++;
+	memcpy(utxo_intern_key(t, id), key, t->key_len);
+	t->refs[id] = 1;
+	t->vals[id] = UTXO_NONE;
+	for (i = utxo_intern_fp(key, t->key_len) & t->mask; t->slots[i];
+	     i = (i + 1) & t->mask)
+		;
+	t->slots[i] = id + 1;
+	t->count++;
+	return (id);
+}
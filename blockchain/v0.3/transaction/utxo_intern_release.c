@@ -0,0 +1,72 @@
+#include "transaction.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * utxo_intern_key - Gets the key of an ID of an intern table
+ * @t: Table
+ * @id: ID
+ *
+ * Return: Pointer to the t->key_len bytes of the key
+ */
+uint8_t *utxo_intern_key(utxo_intern_t const *t, uint32_t id)
+{
+	return (t->keys + (size_t)id * t->key_len);
+}
+
+/**
+ * utxo_intern_release - Drops a reference on a key of an intern table
+ * @t: Table
+ * @id: ID of the key
+ *
+ * Description: The last reference frees the ID, the slots following it in
+ * its probe sequence being shifted back. The key stays readable until the
+ * ID is reused.
+ *
+ * Return: Number of references left
+ */
+uint32_t utxo_intern_release(utxo_intern_t *t, uint32_t id)
+{
+	uint32_t i, j, home;
+
+	if (--t->refs[id])
+		return (t->refs[id]);
+	for (i = utxo_intern_fp(utxo_intern_key(t, id), t->key_len) & t->mask;
+	     t->slots[i] != id + 1; i = (i + 1) & t->mask)
+		;
+	for (j = (i + 1) & t->mask; t->slots[j]; j = (j + 1) & t->mask)
+	{
+		home = utxo_intern_fp(utxo_intern_key(t, t->slots[j] - 1),
+				      t->key_len) & t->mask;
+		if (((j - home) & t->mask) >= ((j - i) & t->mask))
+		{
+			t->slots[i] = t->slots[j];
+			i = j;
+		}
+	}
+	t->slots[i] = 0;
+	t->vals[id] = t->free_id;
+	t->free_id = id;
+	t->count--;
+	return (0);
+}
+
+/**
+ * utxo_intern_destroy - Frees the storage of an intern table
+ * @t: Table, left empty
+ */
+void utxo_intern_destroy(utxo_intern_t *t)
+{
+	free(t->keys);
+	free(t->refs);
+	free(t->vals);
+	free(t->slots);
+	t->keys = NULL;
+	t->refs = NULL;
+	t->vals = NULL;
+	t->slots = NULL;
+	t->count = 0;
+	t->nb_ids = 0;
+	t->cap = 0;
+	t->free_id = UTXO_NONE;
+}
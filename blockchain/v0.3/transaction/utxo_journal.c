@@ -0,0 +1,137 @@
+#include "transaction.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * journal_grow - Doubles the capacity of a journal
+ * @journal: Journal
+ *
+ * Description: Slot indices of a probe run are consecutive, they are
+ * mixed before indexing so that runs do not cluster in @index.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int journal_grow(utxo_journal_t *journal)
+{
+	size_t cap = journal->mask + 1, i, j;
+	uint64_t *slots;
+	utxo_rec_t *recs;
+	uint32_t *index;
+
+	slots = realloc(journal->slots, cap * sizeof(*slots));
+	if (!slots)
+		return (0);
+	journal->slots = slots;
+	recs = realloc(journal->recs, cap * sizeof(*recs));
+	if (!recs)
+		return (0);
+	journal->recs = recs;
+	index = calloc(cap * 2, sizeof(*index));
+	if (!index)
+		return (0);
+	free(journal->index);
+	journal->index = index;
+	journal->mask = cap * 2 - 1;
+	for (i = 0; i < journal->count; i++)
+	{
+		j = (journal->slots[i] * 0x9e3779b97f4a7c15ULL) & journal->mask;
+		while (index[j])
+			j = (j + 1) & journal->mask;
+		index[j] = (uint32_t)i + 1;
+	}
+	return (1);
+}
+
+/**
+ * utxo_journal_begin - Starts collecting the writes to a disk-backed table
+ * @disk: Table, without a journal
+ *
+ * Description: Until utxo_journal_end, slots written with utxo_disk_write
+ * are kept in the journal and read back from it. The table must not grow
+ * meanwhile, see utxo_disk_reserve.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_journal_begin(utxo_disk_t *disk)
+{
+	utxo_journal_t *journal = calloc(1, sizeof(*journal));
+
+	if (!journal)
+		return (0);
+	journal->saved = disk->count;
+	disk->journal = journal;
+	/* Grown from half its initial capacity */
+	journal->mask = UTXO_JOURNAL_SLOTS - 1;
+	if (!journal_grow(journal))
+		return (utxo_journal_end(disk, 0), 0);
+	return (1);
+}
+
+/**
+ * utxo_journal_end - Stops collecting the writes to a disk-backed table
+ * @disk: Table with a journal
+ * @keep: 1 if the writes reached the file, 0 to drop them
+ *
+ * Description: Dropping the writes restores the number of outputs of the
+ * table, which the file still holds.
+ */
+void utxo_journal_end(utxo_disk_t *disk, int keep)
+{
+	utxo_journal_t *journal = disk->journal;
+
+	if (!keep)
+		disk->count = journal->saved;
+	free(journal->slots);
+	free(journal->recs);
+	free(journal->index);
+	free(journal);
+	disk->journal = NULL;
+}
+
+/**
+ * utxo_journal_find - Finds the image of a slot in a journal
+ * @journal: Journal
+ * @i: Index of the slot in the table
+ *
+ * Return: Pointer to the image, or NULL if the slot was not written
+ */
+utxo_rec_t *utxo_journal_find(utxo_journal_t const *journal, uint64_t i)
+{
+	size_t j;
+
+	for (j = (i * 0x9e3779b97f4a7c15ULL) & journal->mask; journal->index[j];
+	     j = (j + 1) & journal->mask)
+	{
+		if (journal->slots[journal->index[j] - 1] == i)
+			return (&journal->recs[journal->index[j] - 1]);
+	}
+	return (NULL);
+}
+
+/**
+ * utxo_journal_add - Records the image of a slot in a journal
+ * @journal: Journal
+ * @i: Index of the slot in the table
+ * @rec: Image of the slot, replacing the one recorded before
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_journal_add(utxo_journal_t *journal, uint64_t i,
+	utxo_rec_t const *rec)
+{
+	utxo_rec_t *image = utxo_journal_find(journal, i);
+	size_t j;
+
+	if (image)
+		return (*image = *rec, 1);
+	if ((journal->count + 1) * 2 > journal->mask + 1 &&
+	    !journal_grow(journal))
+		return (0);
+	for (j = (i * 0x9e3779b97f4a7c15ULL) & journal->mask; journal->index[j];
+	     j = (j + 1) & journal->mask)
+		;
+	journal->slots[journal->count] = i;
+	journal->recs[journal->count] = *rec;
+	journal->index[j] = (uint32_t)++journal->count;
+	return (1);
+}
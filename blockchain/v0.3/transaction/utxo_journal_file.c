@@ -0,0 +1,165 @@
+#include "transaction.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/**
+ * journal_apply - Writes the images of a journal to its table, then the
+ * header, and removes the journal file
+ * @disk: Table, without a journal in memory
+ * @buf: Content of the journal file, checked
+ * @path: Path of the journal file
+ *
+ * Description: Writing an image does not depend on what the slot held, a
+ * journal written out in part may be written out again from the start.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int journal_apply(utxo_disk_t *disk, uint8_t const *buf,
+	char const *path)
+{
+	uint64_t nb, i, slot;
+	utxo_rec_t rec;
+	size_t recs;
+
+	memcpy(&nb, buf + 24, sizeof(nb));
+	recs = UTXO_JOURNAL_HEADER + nb * sizeof(slot);
+	for (i = 0; i < nb; i++)
+	{
+		memcpy(&slot, buf + UTXO_JOURNAL_HEADER + i * sizeof(slot),
+		       sizeof(slot));
+		memcpy(&rec, buf + recs + i * sizeof(rec), sizeof(rec));
+		if (slot >= disk->nb_slots ||
+		    !utxo_disk_write(disk, slot, &rec))
+			return (0);
+	}
+	memcpy(&disk->count, buf + 16, sizeof(disk->count));
+	memcpy(disk->tip, buf + 32, SHA256_DIGEST_LENGTH);
+	memcpy(&disk->height, buf + 64, sizeof(disk->height));
+	if (!utxo_disk_sync(disk) || (unlink(path) == -1 && errno != ENOENT) ||
+	    !utxo_disk_sync_dir(path))
+		return (0);
+	disk->pending = 0;
+	return (1);
+}
+
+/**
+ * utxo_journal_commit - Writes the journal of a disk-backed table out
+ * @disk: Table with a journal, which is ended
+ * @tip: Hash of the tip the table matches once written out
+ * @height: Height of @tip
+ *
+ * Description: The journal file, the path of the table followed by
+ * ".journal", holds a UTXO_JOURNAL_HEADER byte header: "HBLJ",
+ * UTXO_JOURNAL_VERSION, the endianness byte, the number of slots, of
+ * outputs and of images, @tip and @height. The slot indices and the images
+ * follow, then the SHA-256 digest of everything before. It is synced and
+ * renamed in place before the table is written, and removed once the
+ * table and its header are synced. A crash leaves either the table as it
+ * was or a journal that utxo_disk_open writes out again.
+ *
+ * Return: 1 on success, 0 on failure. The journal is pending if it was
+ * committed but not written out, the table then matches it once
+ * utxo_journal_replay succeeds
+ */
+int utxo_journal_commit(utxo_disk_t *disk,
+	uint8_t const tip[SHA256_DIGEST_LENGTH], uint32_t height)
+{
+	utxo_journal_t *journal = disk->journal;
+	char path[PATH_MAX], tmp[PATH_MAX];
+	uint64_t nb = journal->count;
+	uint8_t *buf;
+	size_t len;
+	int fd, ok;
+
+	len = UTXO_JOURNAL_HEADER + nb * (sizeof(nb) + sizeof(utxo_rec_t));
+	buf = malloc(len + SHA256_DIGEST_LENGTH);
+	if (!buf || snprintf(path, sizeof(path), "%s.journal", disk->path) >=
+	    (int)sizeof(path) || snprintf(tmp, sizeof(tmp), "%s.tmp", path) >=
+	    (int)sizeof(tmp))
+		return (free(buf), utxo_journal_end(disk, 0), 0);
+	memset(buf, 0, UTXO_JOURNAL_HEADER);
+	memcpy(buf, "HBLJ" UTXO_JOURNAL_VERSION, 7);
+	buf[7] = _get_endianness();
+	memcpy(buf + 8, &disk->nb_slots, sizeof(disk->nb_slots));
+	memcpy(buf + 16, &disk->count, sizeof(disk->count));
+	memcpy(buf + 24, &nb, sizeof(nb));
+	memcpy(buf + 32, tip, SHA256_DIGEST_LENGTH);
+	memcpy(buf + 64, &height, sizeof(height));
+	memcpy(buf + UTXO_JOURNAL_HEADER, journal->slots, nb * sizeof(nb));
+	memcpy(buf + UTXO_JOURNAL_HEADER + nb * sizeof(nb), journal->recs,
+	       nb * sizeof(utxo_rec_t));
+	sha256((int8_t const *)buf, len, buf + len);
+
+	fd = open(tmp, O_CREAT | O_WRONLY | O_TRUNC, 0600);
+	ok = fd >= 0 && write(fd, buf, len + SHA256_DIGEST_LENGTH) ==
+		(ssize_t)(len + SHA256_DIGEST_LENGTH) && fdatasync(fd) == 0;
+	ok = (fd < 0 || close(fd) == 0) && ok && rename(tmp, path) == 0;
+	if (!ok)
+		return (unlink(tmp), free(buf), utxo_journal_end(disk, 0), 0);
+	utxo_journal_end(disk, 1);
+	disk->pending = 1;
+	ok = utxo_disk_sync_dir(path) && journal_apply(disk, buf, path);
+	free(buf);
+	return (ok);
+}
+
+/**
+ * utxo_journal_replay - Writes out the journal left by a disk-backed table
+ * @disk: Table, without a journal in memory
+ *
+ * Description: A journal that was not renamed in place never reached the
+ * table, it is removed. A journal that does not check out means the table
+ * cannot be trusted.
+ *
+ * Return: 1 on success or if there is no journal, 0 on failure
+ */
+int utxo_journal_replay(utxo_disk_t *disk)
+{
+	uint8_t digest[SHA256_DIGEST_LENGTH], *buf = NULL;
+	char path[PATH_MAX];
+	uint64_t nb_slots, nb;
+	struct stat st;
+	size_t len;
+	int fd, ok;
+
+	if (snprintf(path, sizeof(path), "%s.journal.tmp", disk->path) >=
+	    (int)sizeof(path))
+		return (0);
+	unlink(path);
+	path[strlen(path) - 4] = '\0';
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		disk->pending = 0;
+		return (errno == ENOENT);
+	}
+	ok = fstat(fd, &st) == 0 &&
+		st.st_size >= UTXO_JOURNAL_HEADER + SHA256_DIGEST_LENGTH;
+	len = ok ? (size_t)st.st_size - SHA256_DIGEST_LENGTH : 0;
+	buf = ok ? malloc(len + SHA256_DIGEST_LENGTH) : NULL;
+	ok = buf && read(fd, buf, len + SHA256_DIGEST_LENGTH) ==
+		(ssize_t)(len + SHA256_DIGEST_LENGTH);
+	close(fd);
+	if (ok)
+	{
+		memcpy(&nb_slots, buf + 8, sizeof(nb_slots));
+		memcpy(&nb, buf + 24, sizeof(nb));
+		sha256((int8_t const *)buf, len, digest);
+		ok = !memcmp(buf, "HBLJ" UTXO_JOURNAL_VERSION, 7) &&
+			buf[7] == _get_endianness() &&
+			nb_slots == disk->nb_slots &&
+			nb <= len / (sizeof(nb) + sizeof(utxo_rec_t)) &&
+			len == UTXO_JOURNAL_HEADER + nb * (sizeof(nb) +
+							  sizeof(utxo_rec_t)) &&
+			!memcmp(digest, buf + len, SHA256_DIGEST_LENGTH) &&
+			journal_apply(disk, buf, path);
+	}
+	free(buf);
+	return (ok);
+}
@@ -0,0 +1,76 @@
+#include "transaction.h"
+#include <string.h>
+
+/**
+ * utxo_owner_link - Adds an entry to the outputs of its owner
+ * @set: Set of unspent outputs
+ * @i: Index of the entry being inserted in @set
+ *
+ * Description: The entry becomes the first output of its owner, the head
+ * of the chain being the value of the owner's key.
+ */
+void utxo_owner_link(utxo_set_t *set, uint32_t i)
+{
+	utxo_entry_t *entry = utxo_set_entry(set, i);
+	uint32_t head = set->keys.vals[entry->key];
+
+	entry->owner_prev = UTXO_NONE;
+	entry->owner_next = head;
+	if (head != UTXO_NONE)
+		utxo_set_entry(set, head)->owner_prev = i;
+	set->keys.vals[entry->key] = i;
+}
+
+/**
+ * utxo_owner_unlink - Removes an entry from the outputs of its owner
+ * @set: Set of unspent outputs
+ * @i: Index of the entry being erased from @set
+ */
+void utxo_owner_unlink(utxo_set_t *set, uint32_t i)
+{
+	utxo_entry_t *entry = utxo_set_entry(set, i);
+
+	if (entry->owner_next != UTXO_NONE)
+		utxo_set_entry(set, entry->owner_next)->owner_prev = entry->owner_prev;
+	if (entry->owner_prev != UTXO_NONE)
+		utxo_set_entry(set, entry->owner_prev)->owner_next = entry->owner_next;
+	else
+		set->keys.vals[entry->key] = entry->owner_next;
+}
+
+/**
+ * utxo_set_for_each_owned - Calls a function on each output of an owner
+ * @set: Set of unspent outputs
+ * @pub: Public key of the owner
+ * @action: Function to call, the set must not be modified meanwhile
+ * @arg: Extra argument passed to @action
+ *
+ * Description: Only the outputs of the owner are visited, the cached ones
+ * first, most recently inserted first. A disk-backed set then scans its
+ * whole file for the others.
+ *
+ * Return: 0 once every output was visited, or the non-zero value
+ * returned by @action, -1 if an argument is NULL
+ */
+int utxo_set_for_each_owned(utxo_set_t const *set,
+	uint8_t const pub[TX_PUB_LEN], utxo_func_t action, void *arg)
+{
+	utxo_entry_t const *entry;
+	unspent_tx_out_t unspent;
+	uint32_t key, i;
+	int ret;
+
+	if (!set || !pub || !action)
+		return (-1);
+	key = utxo_intern_find(&set->keys, pub);
+	for (i = key != UTXO_NONE ? set->keys.vals[key] : UTXO_NONE;
+	     i != UTXO_NONE; i = entry->owner_next)
+	{
+		entry = utxo_set_entry(set, i);
+		utxo_entry_unpack(set, entry, &unspent);
+		ret = action(&unspent, arg);
+		if (ret)
+			return (ret);
+	}
+	return (set->disk ? utxo_set_scan_disk(set, pub, action, arg) : 0);
+}
@@ -0,0 +1,166 @@
+#include "transaction.h"
+#include <string.h>
+
+/**
+ * utxo_set_create - Creates an empty set of unspent outputs
+ * @capacity: Number of outputs to make room for up front, may be 0
+ *
+ * Return: Pointer to the new set, or NULL on failure
+ */
+utxo_set_t *utxo_set_create(size_t capacity)
+{
+	utxo_set_t *set;
+	size_t nb_slots = 16;
+
+	while (nb_slots < capacity * 2)
+		nb_slots *= 2;
+	set = calloc(1, sizeof(*set));
+	if (!set)
+		return (NULL);
+	set->slots = calloc(nb_slots, sizeof(*set->slots));
+	if (!set->slots)
+		return (free(set), NULL);
+	set->mask = nb_slots - 1;
+	set->free_entry = UTXO_NONE;
+	set->keys.key_len = TX_PUB_LEN;
+	set->keys.free_id = UTXO_NONE;
+	set->txs.key_len = UTXO_TX_KEY;
+	set->txs.free_id = UTXO_NONE;
+	set->blocks.key_len = SHA256_DIGEST_LENGTH;
+	set->blocks.free_id = UTXO_NONE;
+	return (set);
+}
+
+/**
+ * utxo_set_destroy - Frees a set of unspent outputs
+ * @set: Set to free
+ *
+ * Description: A disk-backed set is flushed to its file first.
+ */
+void utxo_set_destroy(utxo_set_t *set)
+{
+	uint32_t i;
+
+	if (!set)
+		return;
+	if (set->disk)
+	{
+		utxo_set_flush(set);
+		utxo_disk_close(set->disk);
+	}
+	for (i = 0; i < set->nb_chunks; i++)
+		free(set->chunks[i]);
+	free(set->chunks);
+	utxo_intern_destroy(&set->keys);
+	utxo_intern_destroy(&set->txs);
+	utxo_intern_destroy(&set->blocks);
+	free(set->slots);
+	free(set->dirty);
+	free(set);
+}
+
+/**
+ * utxo_set_size - Counts the outputs of a set
+ * @set: Set of unspent outputs
+ *
+ * Return: Number of unspent outputs in @set
+ */
+size_t utxo_set_size(utxo_set_t const *set)
+{
+	return (set ? set->count : 0);
+}
+
+/**
+ * utxo_set_bytes - Estimates the memory a set uses
+ * @set: Set of unspent outputs
+ *
+ * Description: Each entry is counted with its two slots, the table being
+ * at most half full, and each interned key with its reference count, value
+ * and two slots. The list of entries to flush is counted as allocated.
+ *
+ * Return: Number of bytes
+ */
+size_t utxo_set_bytes(utxo_set_t const *set)
+{
+	utxo_intern_t const *tables[3];
+	size_t bytes, i;
+
+	if (!set)
+		return (0);
+	tables[0] = &set->keys;
+	tables[1] = &set->txs;
+	tables[2] = &set->blocks;
+	bytes = set->nb_entries *
+		(sizeof(utxo_entry_t) + 2 * sizeof(utxo_slot_t)) +
+		set->dirty_cap * sizeof(*set->dirty);
+	for (i = 0; i < 3; i++)
+		bytes += tables[i]->count * (tables[i]->key_len +
+					     4 * sizeof(uint32_t));
+	return (bytes);
+}
+
+/**
+ * utxo_set_fp - Computes the fingerprint of an unspent output key
+ * @block_hash: Hash of the block holding the output
+ * @tx_id: ID of the transaction holding the output
+ * @tx_out_hash: Hash of the output
+ *
+ * Description: The key is made of SHA-256 digests, a word of each is
+ * enough once mixed. The last word of @block_hash is used, its first ones
+ * are zeroed by the proof of work.
+ *
+ * Return: 64-bit fingerprint, its low bits select the home slot
+ */
+uint64_t utxo_set_fp(uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH])
+{
+	uint64_t a, b, c;
+
+	memcpy(&a, block_hash + SHA256_DIGEST_LENGTH - sizeof(a), sizeof(a));
+	memcpy(&b, tx_id, sizeof(b));
+	memcpy(&c, tx_out_hash, sizeof(c));
+	a ^= (b << 21 | b >> 43) ^ (c << 42 | c >> 22);
+	a ^= a >> 33;
+	a *= 0xff51afd7ed558ccdULL;
+	a ^= a >> 33;
+	return (a);
+}
+
+/**
+ * utxo_set_probe - Finds the slot of an unspent output key
+ * @set: Set of unspent outputs
+ * @block_hash: Hash of the block holding the output
+ * @tx_id: ID of the transaction holding the output
+ * @tx_out_hash: Hash of the output
+ * @fp: Fingerprint of the key, from utxo_set_fp
+ *
+ * Description: The block and transaction are resolved to their interned
+ * ID first, entries then compare on that ID and the output hash.
+ *
+ * Return: Index of the slot holding the key, or of the empty slot where it
+ * would be inserted
+ */
+size_t utxo_set_probe(utxo_set_t const *set,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH], uint64_t fp)
+{
+	uint32_t tx = utxo_set_find_tx(set, block_hash, tx_id);
+	utxo_entry_t const *entry;
+	utxo_slot_t const *slot;
+	size_t i;
+
+	for (i = (uint32_t)fp & set->mask; ; i = (i + 1) & set->mask)
+	{
+		slot = &set->slots[i];
+		if (!slot->entry)
+			return (i);
+		if (slot->fp != (uint32_t)fp)
+			continue;
+		entry = utxo_set_entry(set, slot->entry - 1);
+		if (entry->tx == tx &&
+		    !memcmp(entry->out_hash, tx_out_hash, SHA256_DIGEST_LENGTH))
+			return (i);
+	}
+}
@@ -0,0 +1,141 @@
+#include "transaction.h"
+#include <string.h>
+
+/**
+ * utxo_set_grow - Doubles the number of slots of a set
+ * @set: Set of unspent outputs
+ *
+ * Return: 1 on success, 0 on failure
+ */
+static int utxo_set_grow(utxo_set_t *set)
+{
+	utxo_slot_t *old = set->slots;
+	size_t old_mask = set->mask, i, j;
+
+	set->slots = calloc((old_mask + 1) * 2, sizeof(*set->slots));
+	if (!set->slots)
+		return (set->slots = old, 0);
+	set->mask = old_mask * 2 + 1;
+	set->evict_pos = 0;
+	for (i = 0; i <= old_mask; i++)
+	{
+		if (!old[i].entry)
+			continue;
+		for (j = old[i].fp & set->mask; set->slots[j].entry;
+		     j = (j + 1) & set->mask)
+			;
+		set->slots[j] = old[i];
+	}
+	free(old);
+	return (1);
+}
+
+/**
+ * utxo_set_reserve - Makes room for more entries in a set
+ * @set: Set of unspent outputs
+ * @n: Number of entries
+ *
+ * Description: Slots, free entries, interned keys and, in a disk-backed
+ * set, room in the dirty list are allocated up front, so that the next @n
+ * inserts and erases do not fail for lack of memory. Slot indices
+ * obtained before the call are invalidated.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_set_reserve(utxo_set_t *set, size_t n)
+{
+	while ((set->nb_entries + n) * 2 > set->mask + 1)
+	{
+		if (!utxo_set_grow(set))
+			return (0);
+	}
+	return (utxo_entry_reserve(set, n) &&
+		utxo_intern_reserve(&set->keys, n) &&
+		utxo_intern_reserve(&set->txs, n) &&
+		utxo_intern_reserve(&set->blocks, n) &&
+		(!set->disk || utxo_set_reserve_dirty(set, n)));
+}
+
+/**
+ * utxo_set_place - Stores a copy of an unspent output in an empty slot
+ * @set: Set of unspent outputs
+ * @i: Index of the slot, from utxo_set_probe
+ * @fp: Fingerprint of the key of @unspent
+ * @unspent: Unspent output to copy
+ * @state: State of the new entry, tombstones are not linked to their owner
+ *
+ * Description: Dirty entries and tombstones are listed for the next flush.
+ *
+ * Return: Pointer to the new entry, or NULL on failure
+ */
+utxo_entry_t *utxo_set_place(utxo_set_t *set, size_t i, uint64_t fp,
+	unspent_tx_out_t const *unspent, uint32_t state)
+{
+	uint32_t index = utxo_entry_alloc(set);
+	utxo_entry_t *entry;
+
+	if (index == UTXO_NONE)
+		return (NULL);
+	entry = utxo_set_entry(set, index);
+	if (!utxo_entry_pack(set, entry, unspent))
+	{
+		entry->owner_next = set->free_entry;
+		set->free_entry = index;
+		return (NULL);
+	}
+	entry->state = state;
+	if ((state & UTXO_PENDING) && !utxo_set_mark(set, index))
+		return (utxo_entry_free(set, index), NULL);
+	if (!(state & UTXO_DELETED))
+		utxo_owner_link(set, index);
+	set->slots[i].entry = index + 1;
+	set->slots[i].fp = (uint32_t)fp;
+	set->nb_entries++;
+	return (entry);
+}
+
+/**
+ * utxo_set_insert - Adds a copy of an unspent output to a set
+ * @set: Set of unspent outputs
+ * @unspent: Unspent output to copy
+ *
+ * Description: In a disk-backed set, a tombstone of the same key is
+ * revived, otherwise the disk is checked for the key before the output is
+ * cached as dirty.
+ *
+ * Return: 1 on success, 0 on failure or if the output is already in @set
+ */
+int utxo_set_insert(utxo_set_t *set, unspent_tx_out_t const *unspent)
+{
+	utxo_entry_t *entry;
+	uint32_t key;
+	uint64_t fp;
+	size_t i;
+
+	if (!set || !unspent || !utxo_set_reserve(set, 1))
+		return (0);
+	fp = utxo_set_fp(unspent->block_hash, unspent->tx_id, unspent->out.hash);
+	i = utxo_set_probe(set, unspent->block_hash, unspent->tx_id,
+			   unspent->out.hash, fp);
+	entry = set->slots[i].entry ?
+		utxo_set_entry(set, set->slots[i].entry - 1) : NULL;
+	if (entry && !(entry->state & UTXO_DELETED))
+		return (0);
+	if (entry)
+	{
+		key = utxo_intern_add(&set->keys, unspent->out.pub);
+		if (key == UTXO_NONE)
+			return (0);
+		utxo_intern_release(&set->keys, entry->key);
+		entry->key = key;
+		entry->amount = unspent->out.amount;
+		utxo_owner_link(set, set->slots[i].entry - 1);
+		entry->state = UTXO_DIRTY | (entry->state & UTXO_ON_DISK);
+	}
+	else if ((set->disk && utxo_disk_get(set->disk, unspent->block_hash,
+		    unspent->tx_id, unspent->out.hash, NULL) != 0) ||
+		 !utxo_set_place(set, i, fp, unspent, set->disk ? UTXO_DIRTY : 0))
+		return (0);
+	set->count++;
+	return (1);
+}
@@ -0,0 +1,177 @@
+#include "transaction.h"
+#include <string.h>
+
+/**
+ * utxo_set_lookup - Finds an unspent output in a set
+ * @set: Set of unspent outputs
+ * @block_hash: Hash of the block holding the output
+ * @tx_id: ID of the transaction holding the output
+ * @tx_out_hash: Hash of the output
+ * @unspent: Receives a copy of the output if found, may be NULL
+ *
+ * Description: A disk-backed set reads the outputs it does not cache from
+ * its file, and caches them as clean entries when memory allows.
+ *
+ * Return: 1 if the output is in @set, 0 otherwise
+ */
+int utxo_set_lookup(utxo_set_t *set,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH],
+	unspent_tx_out_t *unspent)
+{
+	unspent_tx_out_t on_disk;
+	utxo_slot_t const *slot;
+	utxo_entry_t const *entry;
+	uint64_t fp;
+
+	if (!set || !block_hash || !tx_id || !tx_out_hash)
+		return (0);
+	fp = utxo_set_fp(block_hash, tx_id, tx_out_hash);
+	slot = &set->slots[utxo_set_probe(set, block_hash, tx_id, tx_out_hash,
+					  fp)];
+	if (!slot->entry)
+	{
+		if (!set->disk || utxo_disk_get(set->disk, block_hash, tx_id,
+						tx_out_hash, &on_disk) != 1)
+			return (0);
+		if (unspent)
+			*unspent = on_disk;
+		if (utxo_set_reserve(set, 1))
+			utxo_set_place(set, utxo_set_probe(set, block_hash,
+				tx_id, tx_out_hash, fp), fp, &on_disk,
+				UTXO_ON_DISK);
+		return (1);
+	}
+	entry = utxo_set_entry(set, slot->entry - 1);
+	if (entry->state & UTXO_DELETED)
+		return (0);
+	if (unspent)
+		utxo_entry_unpack(set, entry, unspent);
+	return (1);
+}
+
+/**
+ * utxo_set_remove_slot - Empties a slot of the table of a set
+ * @set: Set of unspent outputs
+ * @i: Index of the slot, its entry freed afterwards
+ *
+ * Description: The entries following the slot in its probe sequence are
+ * shifted back, so the table never holds empty slots inside a sequence.
+ */
+void utxo_set_remove_slot(utxo_set_t *set, size_t i)
+{
+	size_t j, home;
+
+	for (j = (i + 1) & set->mask; set->slots[j].entry; j = (j + 1) & set->mask)
+	{
+		home = set->slots[j].fp & set->mask;
+		/* Entry j may move to i unless its home lies in (i, j] */
+		if (((j - home) & set->mask) >= ((j - i) & set->mask))
+		{
+			set->slots[i] = set->slots[j];
+			i = j;
+		}
+	}
+	set->slots[i].entry = 0;
+	set->nb_entries--;
+}
+
+/**
+ * utxo_set_erase - Removes an unspent output from a set
+ * @set: Set of unspent outputs
+ * @block_hash: Hash of the block holding the output
+ * @tx_id: ID of the transaction holding the output
+ * @tx_out_hash: Hash of the output
+ * @unspent: Receives a copy of the removed output, may be NULL
+ *
+ * Description: In a disk-backed set, the output is replaced by a
+ * tombstone until the next flush.
+ *
+ * Return: 1 if the output was removed, 0 if it was not in @set
+ */
+int utxo_set_erase(utxo_set_t *set,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_id[SHA256_DIGEST_LENGTH],
+	uint8_t const tx_out_hash[SHA256_DIGEST_LENGTH],
+	unspent_tx_out_t *unspent)
+{
+	unspent_tx_out_t on_disk;
+	utxo_entry_t *entry;
+	uint32_t index;
+	uint64_t fp;
+	size_t i;
+
+	if (!set || !block_hash || !tx_id || !tx_out_hash ||
+	    (set->disk && !utxo_set_reserve(set, 1)))
+		return (0);
+	fp = utxo_set_fp(block_hash, tx_id, tx_out_hash);
+	i = utxo_set_probe(set, block_hash, tx_id, tx_out_hash, fp);
+	if (set->slots[i].entry)
+	{
+		index = set->slots[i].entry - 1;
+		entry = utxo_set_entry(set, index);
+		if ((entry->state & UTXO_DELETED) || (set->disk &&
+		    !(entry->state & UTXO_PENDING) && !utxo_set_mark(set, index)))
+			return (0);
+		utxo_owner_unlink(set, index);
+	}
+	else
+	{
+		if (!set->disk || utxo_disk_get(set->disk, block_hash, tx_id,
+						tx_out_hash, &on_disk) != 1)
+			return (0);
+		entry = utxo_set_place(set, i, fp, &on_disk,
+				       UTXO_DELETED | UTXO_ON_DISK);
+		if (!entry)
+			return (0);
+		index = set->slots[i].entry - 1;
+	}
+	if (unspent)
+		utxo_entry_unpack(set, entry, unspent);
+	if (set->disk)
+		entry->state = UTXO_DELETED | (entry->state & UTXO_ON_DISK);
+	else
+	{
+		utxo_set_remove_slot(set, i);
+		utxo_entry_free(set, index);
+	}
+	set->count--;
+	return (1);
+}
+
+/**
+ * utxo_set_for_each - Calls a function on each output of a set
+ * @set: Set of unspent outputs
+ * @action: Function to call, the set must not be modified meanwhile
+ * @arg: Extra argument passed to @action
+ *
+ * Description: Outputs are visited in no particular order, the cached
+ * ones first in a disk-backed set.
+ *
+ * Return: 0 once every output was visited, or the non-zero value
+ * returned by @action, -1 if @set or @action is NULL
+ */
+int utxo_set_for_each(utxo_set_t const *set, utxo_func_t action, void *arg)
+{
+	utxo_entry_t const *entry;
+	unspent_tx_out_t unspent;
+	size_t i;
+	int ret;
+
+	if (!set || !action)
+		return (-1);
+	for (i = 0; i <= set->mask; i++)
+	{
+		entry = set->slots[i].entry ?
+			utxo_set_entry(set, set->slots[i].entry - 1) : NULL;
+		if (entry && !(entry->state & UTXO_DELETED))
+		{
+			utxo_entry_unpack(set, entry, &unspent);
+			ret = action(&unspent, arg);
+			if (ret)
+				return (ret);
+		}
+	}
+	return (set->disk ? utxo_set_scan_disk(set, NULL, action, arg) : 0);
+}
@@ -0,0 +1,131 @@
+#include "transaction.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * write_utxo - Writes an unspent output to a snapshot
+ * @unspent: Unspent output
+ * @arg: Pointer to the write_buf_t
+ *
+ * Return: 0 to keep iterating, 1 to stop on failure
+ */
+static int write_utxo(unspent_tx_out_t const *unspent, void *arg)
+{
+	write_buf_t *w = arg;
+
+	write_buf_put(w, unspent, sizeof(*unspent));
+	return (w->failed);
+}
+
+/**
+ * utxo_snapshot_save - Writes a set of unspent outputs to a snapshot file
+ * @set: Set of unspent outputs
+ * @tip: Hash of the last block applied to @set
+ * @height: Number of blocks applied to @set
+ * @path: Path of the snapshot file
+ *
+ * Description: The file holds a UTXO_SNAPSHOT_HEADER byte header: "HBLU",
+ * UTXO_SNAPSHOT_VERSION, the endianness byte, @tip, @height and the number
+ * of outputs.
+ * The outputs follow as unspent_tx_out_t records. The file is removed if
+ * it cannot be written in full.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_snapshot_save(utxo_set_t const *set,
+	uint8_t const tip[SHA256_DIGEST_LENGTH], uint32_t height, char const *path)
+{
+	uint8_t header[UTXO_SNAPSHOT_HEADER] = "HBLU" UTXO_SNAPSHOT_VERSION;
+	uint32_t count;
+	write_buf_t w;
+	int fd, ok;
+
+	if (!set || !tip || !path)
+		return (0);
+	header[7] = _get_endianness();
+	memcpy(header + 8, tip, SHA256_DIGEST_LENGTH);
+	memcpy(header + 40, &height, sizeof(height));
+	count = (uint32_t)utxo_set_size(set);
+	memcpy(header + 44, &count, sizeof(count));
+
+	fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0600);
+	if (fd < 0)
+		return (0);
+	if (!write_buf_init(&w, fd))
+		return (close(fd), unlink(path), 0);
+	write_buf_put(&w, header, sizeof(header));
+	utxo_set_for_each(set, write_utxo, &w);
+	ok = write_buf_flush(&w);
+	write_buf_destroy(&w);
+	ok = close(fd) == 0 && ok;
+	if (!ok)
+		unlink(path);
+	return (ok);
+}
+
+/**
+ * utxo_snapshot_load - Loads a set of unspent outputs from a snapshot file
+ * @path: Path of the snapshot file
+ * @tip: Hash of the block the set must match
+ * @height: Number of blocks the set must match
+ *
+ * Description: The file is mapped and read in one sequential pass. The
+ * set is sized for its outputs up front, and @tip becomes its tip.
+ *
+ * Return: Pointer to the set, or NULL if the file is missing, malformed
+ * or does not match @tip and @height
+ */
+utxo_set_t *utxo_snapshot_load(char const *path,
+	uint8_t const tip[SHA256_DIGEST_LENGTH], uint32_t height)
+{
+	unspent_tx_out_t unspent;
+	utxo_set_t *set = NULL;
+	struct stat st;
+	uint8_t *map;
+	uint32_t count, i;
+	int fd, swap;
+
+	fd = path && tip ? open(path, O_RDONLY) : -1;
+	if (fd < 0)
+		return (NULL);
+	if (fstat(fd, &st) == -1 || st.st_size < UTXO_SNAPSHOT_HEADER)
+		return (close(fd), NULL);
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return (NULL);
+	madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	swap = map[7] != _get_endianness();
+	count = hblk_load32(map + 44, swap);
+	if (memcmp(map, "HBLU" UTXO_SNAPSHOT_VERSION, 7) == 0 &&
+	    (map[7] == 1 || map[7] == 2) &&
+	    memcmp(map + 8, tip, SHA256_DIGEST_LENGTH) == 0 &&
+	    hblk_load32(map + 40, swap) == height &&
+	    (uint64_t)st.st_size == UTXO_SNAPSHOT_HEADER +
+	    (uint64_t)count * sizeof(unspent))
+		set = utxo_set_create(count);
+	for (i = 0; set && i < count; i++)
+	{
+		memcpy(&unspent, map + UTXO_SNAPSHOT_HEADER + i * sizeof(unspent),
+		       sizeof(unspent));
+		if (swap)
+			unspent.out.amount = __builtin_bswap32(unspent.out.amount);
+		if (!utxo_set_insert(set, &unspent))
+		{
+			utxo_set_destroy(set);
+			set = NULL;
+		}
+	}
+	munmap(map, (size_t)st.st_size);
+	if (set)
+	{
+		memcpy(set->tip, tip, SHA256_DIGEST_LENGTH);
+		set->height = height;
+	}
+	return (set);
+}
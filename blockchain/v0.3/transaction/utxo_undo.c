@@ -0,0 +1,173 @@
+#include "transaction.h"
+#include <string.h>
+
+/**
+ * struct unspent_undo_s - State shared by the disconnect callbacks
+ *
+ * @set:        Set of unspent outputs being rolled back
+ * @block_hash: Hash of the block being disconnected
+ * @tx_id:      ID of the transaction whose outputs are removed
+ */
+typedef struct unspent_undo_s
+{
+	utxo_set_t *set;
+	uint8_t const *block_hash;
+	uint8_t const *tx_id;
+} unspent_undo_t;
+
+/**
+ * count_io - Counts the inputs and outputs of a transaction
+ * @node: Pointer to the transaction_t
+ * @idx: Index of the transaction, unused
+ * @arg: Pointer to two size_t, the numbers of inputs and of outputs
+ *
+ * Return: Always 0
+ */
+static int count_io(llist_node_t node, unsigned int idx, void *arg)
+{
+	transaction_t const *tx = node;
+	size_t *counts = arg;
+
+	(void)idx;
+	if (tx && llist_size(tx->inputs) > 0)
+		counts[0] += (size_t)llist_size(tx->inputs);
+	if (tx && llist_size(tx->outputs) > 0)
+		counts[1] += (size_t)llist_size(tx->outputs);
+	return (0);
+}
+
+/**
+ * utxo_undo_reserve - Makes room in a set for a block to be applied or
+ * disconnected
+ * @set: Set of unspent outputs
+ * @transactions: List of transactions of the block
+ * @undo: Undo record of the block to disconnect, NULL for a block about to
+ *        be applied
+ * @nb_inputs: Receives the number of inputs of the block, may be NULL
+ *
+ * Description: Applying a block erases at most one output per input and
+ * inserts its outputs, disconnecting it erases its outputs and restores
+ * the ones it spent. Before a block is applied, room is made for both, so
+ * that the rollback of a failed application finds its room already made.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_undo_reserve(utxo_set_t *set, llist_t *transactions,
+		      utxo_undo_t const *undo, size_t *nb_inputs)
+{
+	size_t counts[2] = {0, 0};
+
+	llist_for_each(transactions, count_io, counts);
+	if (nb_inputs)
+		*nb_inputs = counts[0];
+	if (undo)
+		return (utxo_set_reserve(set, counts[1] + undo->nb_spent));
+	return (utxo_set_reserve(set, 2 * (counts[0] + counts[1])));
+}
+
+/**
+ * remove_output - Removes an output created by the block being
+ * disconnected
+ * @node: Pointer to the tx_out_t
+ * @idx: Index of the output, unused
+ * @arg: Pointer to the unspent_undo_t
+ *
+ * Return: Always 0, outputs already spent are not in the set anymore
+ */
+static int remove_output(llist_node_t node, unsigned int idx, void *arg)
+{
+	tx_out_t const *out = node;
+	unspent_undo_t *undo = arg;
+
+	(void)idx;
+	if (out)
+		utxo_set_erase(undo->set, undo->block_hash, undo->tx_id, out->hash,
+			       NULL);
+	return (0);
+}
+
+/**
+ * remove_outputs - Removes the outputs of a transaction of the block
+ * being disconnected
+ * @node: Pointer to the transaction_t
+ * @idx: Index of the transaction, unused
+ * @arg: Pointer to the unspent_undo_t
+ *
+ * Return: Always 0
+ */
+static int remove_outputs(llist_node_t node, unsigned int idx, void *arg)
+{
+	transaction_t const *tx = node;
+	unspent_undo_t *undo = arg;
+
+	(void)idx;
+	if (!tx)
+		return (0);
+	undo->tx_id = tx->id;
+	llist_for_each(tx->outputs, remove_output, undo);
+	return (0);
+}
+
+/**
+ * utxo_set_disconnect - Reverts the application of a block to a set of
+ * unspent outputs
+ * @set: Set of unspent outputs, as left by utxo_set_apply
+ * @transactions: List of transactions of the block
+ * @block_hash: Hash of the block
+ * @undo: Undo record returned by utxo_set_apply for the block
+ *
+ * Description: The outputs created by the block are removed and the ones
+ * it spent are restored, except those it had created itself. Blocks must
+ * be disconnected from the tip down. Memory is reserved first, see
+ * utxo_undo_reserve: if that fails @set is left as is, and past it only
+ * the file of a disk-backed set can fail. The tip and height of @set go
+ * back to those before the block, or are zeroed if the file failed. A
+ * disk-backed set is checkpointed afterwards, a failed flush being retried
+ * at the next block.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int utxo_set_disconnect(utxo_set_t *set, llist_t *transactions,
+	uint8_t const block_hash[SHA256_DIGEST_LENGTH], utxo_undo_t const *undo)
+{
+	unspent_undo_t ctx;
+	uint32_t i;
+	int ok = 1;
+
+	if (!set || !transactions || !block_hash || !undo ||
+	    !utxo_undo_reserve(set, transactions, undo, NULL))
+		return (0);
+	ctx.set = set;
+	ctx.block_hash = block_hash;
+	ctx.tx_id = NULL;
+	llist_for_each(transactions, remove_outputs, &ctx);
+	for (i = 0; i < undo->nb_spent; i++)
+	{
+		if (memcmp(undo->spent[i].block_hash, block_hash,
+			   SHA256_DIGEST_LENGTH) == 0)
+			continue;
+		if (!utxo_set_insert(set, &undo->spent[i]))
+			ok = 0;
+	}
+	memset(set->tip, 0, SHA256_DIGEST_LENGTH);
+	set->height = 0;
+	if (ok)
+	{
+		memcpy(set->tip, undo->prev_tip, SHA256_DIGEST_LENGTH);
+		set->height = undo->prev_height;
+	}
+	utxo_set_checkpoint(set);
+	return (ok);
+}
+
+/**
+ * utxo_undo_destroy - Frees an undo record
+ * @undo: Undo record to free
+ */
+void utxo_undo_destroy(utxo_undo_t *undo)
+{
+	if (!undo)
+		return;
+	free(undo->spent);
+	free(undo);
+}
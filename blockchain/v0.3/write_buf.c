@@ -0,0 +1,88 @@
+#include "blockchain.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+/**
+ * write_buf_init - Initializes a buffered writer
+ * @w: Writer to initialize
+ * @fd: File descriptor to write to
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int write_buf_init(write_buf_t *w, int fd)
+{
+	void *buf;
+
+	memset(w, 0, sizeof(*w));
+	if (posix_memalign(&buf, 4096, WRITE_BUF_SIZE) != 0)
+		return (0);
+	w->fd = fd;
+	w->buf = buf;
+	return (1);
+}
+
+/**
+ * write_buf_flush - Writes out the pending bytes of a buffered writer
+ * @w: Writer
+ *
+ * Return: 1 on success, 0 if this or an earlier write failed
+ */
+int write_buf_flush(write_buf_t *w)
+{
+	size_t done = 0;
+	ssize_t n;
+
+	while (!w->failed && done < w->len)
+	{
+		n = write(w->fd, w->buf + done, w->len - done);
+		w->nb_writes++;
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			w->failed = 1;
+		else
+			done += (size_t)n;
+	}
+	w->len = 0;
+	return (!w->failed);
+}
+
+/**
+ * write_buf_put - Appends bytes to a buffered writer
+ * @w: Writer
+ * @data: Bytes to append
+ * @len: Number of bytes
+ *
+ * Description: The buffer is flushed each time it fills up. Failures are
+ * recorded in @w and reported by write_buf_flush.
+ */
+void write_buf_put(write_buf_t *w, void const *data, size_t len)
+{
+	uint8_t const *p = data;
+	size_t chunk;
+
+	w->total += len;
+	while (!w->failed && len)
+	{
+		if (w->len == WRITE_BUF_SIZE)
+			write_buf_flush(w);
+		chunk = WRITE_BUF_SIZE - w->len;
+		chunk = chunk < len ? chunk : len;
+		memcpy(w->buf + w->len, p, chunk);
+		w->len += chunk, p += chunk, len -= chunk;
+	}
+}
+
+/**
+ * write_buf_destroy - Releases the buffer of a writer, pending bytes are
+ * dropped
+ * @w: Writer
+ */
+void write_buf_destroy(write_buf_t *w)
+{
+	free(w->buf);
+	w->buf = NULL;
+	w->len = 0;
+}
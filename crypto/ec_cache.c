@@ -0,0 +1,200 @@
+#include "hblk_crypto.h"
+#include <string.h>
+
+/**
+ * struct ec_cache_way_s - Cached public key
+ * @pub: Public key, in either form, see ec_pub_len
+ * @len: Number of bytes of @pub in use
+ * @key: Decoded key, the cache holds one reference to it, NULL if unused
+ * @stamp: Value of the set's clock when last used
+ */
+typedef struct ec_cache_way_s
+{
+	uint8_t pub[EC_PUB_LEN];
+	uint8_t len;
+	EC_KEY *key;
+	uint32_t stamp;
+} ec_cache_way_t;
+
+/**
+ * struct ec_cache_set_s - Set of the public key cache
+ * @lock: Spinlock, held only while the ways are scanned or replaced
+ * @clock: Incremented on each use of a way of the set
+ * @ways: Keys mapped to the set
+ */
+typedef struct ec_cache_set_s
+{
+	unsigned char lock;
+	uint32_t clock;
+	ec_cache_way_t ways[EC_CACHE_WAYS];
+} ec_cache_set_t;
+
+static ec_cache_set_t ec_cache[EC_CACHE_SETS];
+static ec_cache_stats_t ec_cache_counters;
+
+/**
+ * ec_cache_lookup - Looks a public key up in its set, with the lock held
+ * @set: Set the key maps to
+ * @pub: Public key
+ * @len: Size of @pub
+ *
+ * Return: New reference to the cached key, or NULL if it is not cached
+ */
+static EC_KEY *ec_cache_lookup(ec_cache_set_t *set, uint8_t const *pub,
+	size_t len)
+{
+	unsigned int i;
+
+	for (i = 0; i < EC_CACHE_WAYS; i++)
+	{
+		if (set->ways[i].key && set->ways[i].len == len &&
+		    !memcmp(set->ways[i].pub, pub, len))
+		{
+			set->ways[i].stamp = ++set->clock;
+			EC_KEY_up_ref(set->ways[i].key);
+			return (set->ways[i].key);
+		}
+	}
+	return (NULL);
+}
+
+/**
+ * ec_cache_store - Stores a key in its set, with the lock held
+ * @set: Set the key maps to
+ * @pub: Public key
+ * @len: Size of @pub, at most EC_PUB_LEN
+ * @key: Decoded key, the set takes over one reference to it
+ *
+ * Return: Key evicted from the set, to be freed once the lock is
+ * released, or NULL
+ */
+static EC_KEY *ec_cache_store(ec_cache_set_t *set, uint8_t const *pub,
+	size_t len, EC_KEY *key)
+{
+	unsigned int i, victim = 0;
+	EC_KEY *evicted;
+
+	for (i = 0; i < EC_CACHE_WAYS; i++)
+	{
+		if (!set->ways[i].key)
+		{
+			victim = i;
+			break;
+		}
+		if ((uint32_t)(set->clock - set->ways[i].stamp) >
+		    (uint32_t)(set->clock - set->ways[victim].stamp))
+			victim = i;
+	}
+	evicted = set->ways[victim].key;
+	memcpy(set->ways[victim].pub, pub, len);
+	set->ways[victim].len = (uint8_t)len;
+	set->ways[victim].key = key;
+	set->ways[victim].stamp = ++set->clock;
+	return (evicted);
+}
+
+/**
+ * ec_from_pub_cached - Gets the EC_KEY of a public key through a cache
+ * @pub: Public key buffer, in uncompressed or compressed form
+ * @len: Size of @pub, which must match the form its first byte announces,
+ *       see ec_pub_len
+ *
+ * Description: Decoded keys are kept in a bounded set-associative cache,
+ * the least recently used key of a set being evicted. The cache is safe
+ * to use from several threads, keys are decoded outside of its locks.
+ * The key returned is shared with the cache and must not be modified, it
+ * is released with ec_key_release like any other key.
+ *
+ * Return: Reference to the key, or NULL on failure
+ */
+EC_KEY *ec_from_pub_cached(uint8_t const *pub, size_t len)
+{
+	ec_cache_set_t *set;
+	EC_KEY *key, *theirs, *evicted = NULL;
+	uint64_t x;
+
+	if (!len || ec_pub_len(pub) != len)
+		return (NULL);
+	/* Skip the leading form byte, the X coordinate is uniform enough */
+	memcpy(&x, pub + 1, sizeof(x));
+	set = &ec_cache[(x ^ x >> 29) & (EC_CACHE_SETS - 1)];
+
+	while (__atomic_test_and_set(&set->lock, __ATOMIC_ACQUIRE))
+		;
+	key = ec_cache_lookup(set, pub, len);
+	__atomic_clear(&set->lock, __ATOMIC_RELEASE);
+	if (key)
+	{
+		__atomic_add_fetch(&ec_cache_counters.hits, 1, __ATOMIC_RELAXED);
+		return (key);
+	}
+
+	__atomic_add_fetch(&ec_cache_counters.misses, 1, __ATOMIC_RELAXED);
+	key = ec_from_pub(pub, len);
+	if (!key || !EC_KEY_up_ref(key))
+		return (key);
+	while (__atomic_test_and_set(&set->lock, __ATOMIC_ACQUIRE))
+		;
+	theirs = ec_cache_lookup(set, pub, len);
+	if (!theirs)
+		evicted = ec_cache_store(set, pub, len, key);
+	__atomic_clear(&set->lock, __ATOMIC_RELEASE);
+	if (theirs)
+	{
+		/* Another thread cached the same key meanwhile */
+		EC_KEY_free(key);
+		EC_KEY_free(key);
+		return (theirs);
+	}
+	if (evicted)
+	{
+		__atomic_add_fetch(&ec_cache_counters.evictions, 1,
+				   __ATOMIC_RELAXED);
+		EC_KEY_free(evicted);
+	}
+	return (key);
+}
+
+/**
+ * ec_cache_stats - Reads the counters of the public key cache
+ * @stats: Receives the counters
+ */
+void ec_cache_stats(ec_cache_stats_t *stats)
+{
+	if (!stats)
+		return;
+	stats->hits = __atomic_load_n(&ec_cache_counters.hits, __ATOMIC_RELAXED);
+	stats->misses = __atomic_load_n(&ec_cache_counters.misses,
+					__ATOMIC_RELAXED);
+	stats->evictions = __atomic_load_n(&ec_cache_counters.evictions,
+					   __ATOMIC_RELAXED);
+}
+
+/**
+ * ec_cache_clear - Empties the public key cache and resets its counters
+ *
+ * Description: Keys still referenced by callers stay valid until they
+ * free them.
+ */
+void ec_cache_clear(void)
+{
+	EC_KEY *key;
+	unsigned int i, j;
+
+	for (i = 0; i < EC_CACHE_SETS; i++)
+	{
+		for (j = 0; j < EC_CACHE_WAYS; j++)
+		{
+			while (__atomic_test_and_set(&ec_cache[i].lock,
+						     __ATOMIC_ACQUIRE))
+				;
+			key = ec_cache[i].ways[j].key;
+			ec_cache[i].ways[j].key = NULL;
+			__atomic_clear(&ec_cache[i].lock, __ATOMIC_RELEASE);
+			EC_KEY_free(key);
+		}
+	}
+	__atomic_store_n(&ec_cache_counters.hits, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&ec_cache_counters.misses, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&ec_cache_counters.evictions, 0, __ATOMIC_RELAXED);
+}
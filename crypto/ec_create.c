@@ -26,3 +26,17 @@ EC_KEY *ec_create(void)
 
 	return (key);
 }
+
+/**
+ * ec_key_release - Releases a reference to an EC key
+ * @key: Key, as returned by ec_create, ec_load, ec_from_pub or
+ *       ec_from_pub_cached, may be NULL
+ *
+ * Description: Callers outside this library use this rather than
+ * EC_KEY_free, deprecated since OpenSSL 3.0, so they build without
+ * silencing deprecation warnings.
+ */
+void ec_key_release(EC_KEY *key)
+{
+	EC_KEY_free(key);
+}
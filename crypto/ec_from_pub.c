@@ -1,18 +1,37 @@
 #include "hblk_crypto.h"
 
+/**
+ * ec_pub_len - Gets the length of a public key from its first byte
+ * @pub: Public key, in uncompressed or compressed form
+ *
+ * Return: EC_PUB_LEN or EC_PUB_COMPRESSED_LEN, 0 for an unknown form
+ */
+size_t ec_pub_len(uint8_t const *pub)
+{
+	if (!pub)
+		return (0);
+	if (pub[0] == 0x04)
+		return (EC_PUB_LEN);
+	if (pub[0] == 0x02 || pub[0] == 0x03)
+		return (EC_PUB_COMPRESSED_LEN);
+	return (0);
+}
+
 /**
  * ec_from_pub - Creates an EC_KEY structure from a public key buffer
- * @pub: Pointer to the public key buffer (uncompressed format)
+ * @pub: Pointer to the public key buffer, in uncompressed or compressed
+ *       form, see ec_pub_len
+ * @len: Size of @pub, which must match the form its first byte announces
  *
  * Return: Pointer to newly created EC_KEY, or NULL on failure
  */
-EC_KEY *ec_from_pub(uint8_t const pub[EC_PUB_LEN])
+EC_KEY *ec_from_pub(uint8_t const *pub, size_t len)
 {
 	EC_KEY *key = NULL;
 	EC_GROUP *group = NULL;
 	EC_POINT *point = NULL;
 
-	if (!pub)
+	if (!len || ec_pub_len(pub) != len)
 		return (NULL);
 
 	/* Create new EC_KEY using curve NID_secp256k1 */
@@ -29,7 +48,7 @@ EC_KEY *ec_from_pub(uint8_t const pub[EC_PUB_LEN])
 	}
 
 	/* Convert octet string to EC_POINT */
-	if (!EC_POINT_oct2point(group, point, pub, EC_PUB_LEN, NULL))
+	if (!EC_POINT_oct2point(group, point, pub, len, NULL))
 	{
 		EC_POINT_free(point);
 		EC_KEY_free(key);
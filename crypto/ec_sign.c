@@ -1,7 +1,6 @@
 #include "hblk_crypto.h"
 #include <openssl/ecdsa.h>
 #include <string.h>
-#include <stdlib.h>
 
 /**
  * ec_sign - Signs a given set of bytes using a given EC_KEY private key
@@ -10,29 +9,34 @@
  * @msglen: length of the message to sign
  * @sig: pointer to the signature structure to fill
  *
+ * Description: The signature is stored as r then s, each padded to 32
+ * bytes. It never goes through DER.
+ *
  * Return: pointer to the signature buffer on success, or NULL on failure
  */
 uint8_t *ec_sign(EC_KEY const *key,
 	uint8_t const *msg, size_t msglen, sig_t *sig)
 {
-	unsigned int sig_len = 0;
+	ECDSA_SIG *ecdsa;
+	BIGNUM const *r, *s;
+	int ok;
 
 	if (!key || !msg || !sig)
 		return (NULL);
 
-	/* Allocate a buffer large enough to hold a DER-encoded ECDSA signature */
-	sig->sig = calloc(ECDSA_size(key), sizeof(uint8_t));
-	if (!sig->sig)
+	ecdsa = ECDSA_do_sign(msg, (int)msglen, (EC_KEY *)key);
+	if (!ecdsa)
 		return (NULL);
-
-	/* Sign the message */
-	if (!ECDSA_sign(0, msg, msglen, sig->sig, &sig_len, (EC_KEY *)key))
+	ECDSA_SIG_get0(ecdsa, &r, &s);
+	ok = BN_bn2binpad(r, sig->sig, SIG_LEN / 2) == SIG_LEN / 2 &&
+		BN_bn2binpad(s, sig->sig + SIG_LEN / 2, SIG_LEN / 2) == SIG_LEN / 2;
+	ECDSA_SIG_free(ecdsa);
+	if (!ok)
 	{
-		free(sig->sig);
-		sig->sig = NULL;
+		memset(sig, 0, sizeof(*sig));
 		return (NULL);
 	}
 
-	sig->len = sig_len;
+	sig->len = SIG_LEN;
 	return (sig->sig);
 }
@@ -28,3 +28,54 @@ uint8_t *ec_to_pub(EC_KEY const *key, uint8_t pub[EC_PUB_LEN])
 
 	return (pub);
 }
+
+/**
+ * ec_to_pub_compressed - Extracts the public key from an EC_KEY opaque
+ * structure, in compressed form
+ * @key: Pointer to EC_KEY structure containing the key pair
+ * @pub: Buffer in which to store the public key, 0x02 or 0x03 for the
+ *       parity of Y, then X
+ *
+ * Return: Pointer to @pub on success, or NULL on failure
+ */
+uint8_t *ec_to_pub_compressed(EC_KEY const *key,
+	uint8_t pub[EC_PUB_COMPRESSED_LEN])
+{
+	const EC_POINT *pub_key_point;
+	const EC_GROUP *group;
+
+	if (!key || !pub)
+		return (NULL);
+
+	group = EC_KEY_get0_group(key);
+	pub_key_point = EC_KEY_get0_public_key(key);
+	if (!group || !pub_key_point)
+		return (NULL);
+
+	if (EC_POINT_point2oct(group, pub_key_point, POINT_CONVERSION_COMPRESSED,
+			       pub, EC_PUB_COMPRESSED_LEN, NULL) !=
+	    EC_PUB_COMPRESSED_LEN)
+		return (NULL);
+
+	return (pub);
+}
+
+/**
+ * ec_pub_compress - Converts an uncompressed public key to compressed form
+ * @pub: Public key, in uncompressed form
+ * @out: Buffer in which to store the compressed key
+ *
+ * Description: Only the bytes are rearranged, the point is not checked
+ * to lie on the curve.
+ *
+ * Return: Pointer to @out on success, or NULL if @pub is not uncompressed
+ */
+uint8_t *ec_pub_compress(uint8_t const pub[EC_PUB_LEN],
+	uint8_t out[EC_PUB_COMPRESSED_LEN])
+{
+	if (!pub || !out || pub[0] != 0x04)
+		return (NULL);
+	out[0] = 0x02 | (pub[EC_PUB_LEN - 1] & 1);
+	memcpy(out + 1, pub + 1, EC_PUB_COMPRESSED_LEN - 1);
+	return (out);
+}
@@ -1,6 +1,5 @@
 #include "hblk_crypto.h"
 #include <openssl/ecdsa.h>
-#include <stdlib.h>
 
 /**
  * ec_verify - Verifies the signature of a given set of bytes using a given EC_KEY public key
@@ -12,13 +11,27 @@
  */
 int ec_verify(EC_KEY const *key, uint8_t const *msg, size_t msglen, sig_t const *sig)
 {
-	if (!key || !msg || !sig || !sig->sig || sig->len == 0)
+	ECDSA_SIG *ecdsa;
+	BIGNUM *r, *s;
+	int verify_status;
+
+	if (!key || !msg || !sig || sig->len != SIG_LEN)
 		return (0);
 
-	/* ECDSA_verify returns 1 for valid, 0 for invalid, -1 for error */
-	int verify_status = ECDSA_verify(0, msg, msglen, sig->sig, (int)sig->len, (EC_KEY *)key);
+	/* Hand r and s to OpenSSL as an ECDSA_SIG, no DER round trip */
+	ecdsa = ECDSA_SIG_new();
+	r = BN_bin2bn(sig->sig, SIG_LEN / 2, NULL);
+	s = BN_bin2bn(sig->sig + SIG_LEN / 2, SIG_LEN / 2, NULL);
+	if (!ecdsa || !r || !s || !ECDSA_SIG_set0(ecdsa, r, s))
+	{
+		BN_free(r);
+		BN_free(s);
+		ECDSA_SIG_free(ecdsa);
+		return (0);
+	}
 
-	if (verify_status == 1)
-		return (1);
-	return (0);
+	/* ECDSA_do_verify returns 1 for valid, 0 for invalid, -1 for error */
+	verify_status = ECDSA_do_verify(msg, (int)msglen, ecdsa, (EC_KEY *)key);
+	ECDSA_SIG_free(ecdsa);
+	return (verify_status == 1);
 }
@@ -12,33 +12,119 @@
 #define PUB_FILENAME "key_pub.pem"
 
 
+/* Largest number of messages hashed together by sha256_batch() */
+#define SHA256_BATCH_MAX 16
+
 /* Define the elliptic curve to use */
 #define EC_CURVE NID_secp256k1
 
-/* Length of the public key in uncompressed form */
+/* Length of the public key in uncompressed form, the longest one */
 #define EC_PUB_LEN 65
 
+/* Length of the public key in compressed form, X and the parity of Y */
+#define EC_PUB_COMPRESSED_LEN 33
+
+/* Length of a signature, r and s of 32 bytes each */
+#define SIG_LEN 64
+
+/* Shape of the cache of ec_from_pub_cached(), EC_CACHE_SETS is a power of 2 */
+#define EC_CACHE_SETS 256
+#define EC_CACHE_WAYS 4
+
 /**
  * struct sig_s - Represents a digital signature
- * @sig: Pointer
- * @len: Length
+ * @sig: Signature, r then s, each a 32-byte big-endian integer
+ * @len: Number of bytes of @sig in use, SIG_LEN once signed, 0 otherwise
  *
  * This structure is used to store a digital signature and its length.
  */
 typedef struct sig_s
 {
-	uint8_t *sig;
-	size_t len;
+	uint8_t sig[SIG_LEN];
+	uint8_t len;
 } sig_t;
 
+/**
+ * struct sha256_ctx_s - Incremental SHA-256 computation
+ * @state: Chaining state
+ * @len: Number of bytes hashed so far
+ * @buf: Pending bytes of the current, incomplete block
+ */
+typedef struct sha256_ctx_s
+{
+	uint32_t state[8];
+	uint64_t len;
+	uint8_t buf[SHA256_CBLOCK];
+} sha256_ctx_t;
+
+/**
+ * struct sha256_tmpl_s - Message hashed repeatedly with 8 changing bytes
+ * @block: Padded message block holding the patch
+ * @patch_off: Offset of the patch in @block
+ * @skip: Rounds of @block that precede the patch, a multiple of 4
+ * @mid: Chaining state entering @block
+ * @part: Working variables after the first @skip rounds of @block
+ * @wk: Schedules (w[i] + k[i]) of the blocks after @block, 64 words each
+ * @nb_trailing: Number of blocks after @block, padding included
+ * @shani: Whether to use the SHA extensions
+ */
+typedef struct sha256_tmpl_s
+{
+	uint8_t block[SHA256_CBLOCK];
+	size_t patch_off;
+	unsigned int skip;
+	uint32_t mid[8];
+	uint32_t part[8];
+	uint32_t *wk;
+	size_t nb_trailing;
+	int shani;
+} sha256_tmpl_t;
+
+/**
+ * struct ec_cache_stats_s - Counters of the public key cache
+ * @hits: Lookups served from the cache
+ * @misses: Lookups that had to decode the public key
+ * @evictions: Keys dropped to make room for others
+ */
+typedef struct ec_cache_stats_s
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+} ec_cache_stats_t;
+
 /* Function prototypes */
 uint8_t *sha256(int8_t const *s, size_t len,
 	uint8_t digest[SHA256_DIGEST_LENGTH]);
+void sha256_init(sha256_ctx_t *ctx);
+void sha256_update(sha256_ctx_t *ctx, void const *data, size_t len);
+uint8_t *sha256_final(sha256_ctx_t *ctx, uint8_t digest[SHA256_DIGEST_LENGTH]);
+int sha256_tmpl_init(sha256_tmpl_t *t, void const *msg, size_t len,
+	size_t patch_off);
+int sha256_tmpl_try(sha256_tmpl_t const *t, uint64_t patch,
+	uint32_t zero_bits, uint8_t digest[SHA256_DIGEST_LENGTH]);
+void sha256_tmpl_destroy(sha256_tmpl_t *t);
+unsigned int sha256_tmpl_lanes(sha256_tmpl_t const *t);
+uint32_t sha256_tmpl_try_batch(sha256_tmpl_t const *t,
+	uint64_t const *patches, unsigned int count, uint32_t zero_bits,
+	uint8_t (*digests)[SHA256_DIGEST_LENGTH]);
+unsigned int sha256_batch_lanes(void);
+int sha256_batch(int8_t const *const *msgs, size_t len, size_t count,
+	uint8_t (*digests)[SHA256_DIGEST_LENGTH]);
 EC_KEY *ec_create(void);
+void ec_key_release(EC_KEY *key);
 uint8_t *ec_to_pub(EC_KEY const *key, uint8_t pub[EC_PUB_LEN]);
+uint8_t *ec_to_pub_compressed(EC_KEY const *key,
+	uint8_t pub[EC_PUB_COMPRESSED_LEN]);
+uint8_t *ec_pub_compress(uint8_t const pub[EC_PUB_LEN],
+	uint8_t out[EC_PUB_COMPRESSED_LEN]);
+size_t ec_pub_len(uint8_t const *pub);
 int ec_save(EC_KEY *key, char const *folder);
 EC_KEY *ec_load(char const *folder);
-EC_KEY *ec_from_pub(uint8_t const pub[EC_PUB_LEN]);
+EC_KEY *ec_from_pub(uint8_t const *pub, size_t len);
+EC_KEY *ec_from_pub_cached(uint8_t const *pub, size_t len);
+void ec_cache_stats(ec_cache_stats_t *stats);
+void ec_cache_clear(void);
 uint8_t *ec_sign(EC_KEY const *key,
 	uint8_t const *msg, size_t msglen, sig_t *sig);
 int ec_verify(EC_KEY const *key, uint8_t const *msg,
@@ -1,5 +1,68 @@
-#include "hblk_crypto.h"
-#include <openssl/sha.h>
+#include "sha256_internal.h"
+
+/**
+ * sha256_init - Starts an incremental SHA-256 computation
+ * @ctx: Context to initialize
+ */
+void sha256_init(sha256_ctx_t *ctx)
+{
+	memcpy(ctx->state, sha256_iv, sizeof(ctx->state));
+	ctx->len = 0;
+}
+
+/**
+ * sha256_update - Feeds bytes to an incremental SHA-256 computation
+ * @ctx: Context started with sha256_init
+ * @data: Bytes to hash
+ * @len: Number of bytes in @data
+ *
+ * Description: Whole blocks are compressed straight from @data, only a
+ * partial trailing block is buffered in @ctx.
+ */
+void sha256_update(sha256_ctx_t *ctx, void const *data, size_t len)
+{
+	uint8_t const *p = data;
+	size_t used = ctx->len % SHA256_CBLOCK, n;
+
+	ctx->len += len;
+	if (used)
+	{
+		n = SHA256_CBLOCK - used < len ? SHA256_CBLOCK - used : len;
+		memcpy(ctx->buf + used, p, n);
+		p += n, len -= n;
+		if (used + n < SHA256_CBLOCK)
+			return;
+		sha256_compress(ctx->state, ctx->buf, 1);
+	}
+	if (len >= SHA256_CBLOCK)
+	{
+		sha256_compress(ctx->state, p, len / SHA256_CBLOCK);
+		p += len - len % SHA256_CBLOCK;
+		len %= SHA256_CBLOCK;
+	}
+	memcpy(ctx->buf, p, len);
+}
+
+/**
+ * sha256_final - Completes an incremental SHA-256 computation
+ * @ctx: Context started with sha256_init
+ * @digest: Buffer to store the resulting hash
+ *
+ * Return: A pointer to digest
+ */
+uint8_t *sha256_final(sha256_ctx_t *ctx, uint8_t digest[SHA256_DIGEST_LENGTH])
+{
+	uint8_t tail[2 * SHA256_CBLOCK];
+	size_t nb;
+	int i;
+
+	nb = sha256_pad_tail(tail, (size_t)ctx->len);
+	memcpy(tail, ctx->buf, ctx->len % SHA256_CBLOCK);
+	sha256_compress(ctx->state, tail, nb);
+	for (i = 0; i < 8; i++)
+		sha256_store_be32(digest + 4 * i, ctx->state[i]);
+	return (digest);
+}
 
 /**
  * sha256 - Computes the SHA-256 hash of a sequence of bytes
@@ -7,14 +70,30 @@
  * @len: The length of the data
  * @digest: Buffer to store the resulting hash
  *
+ * Description: One-shot version of sha256_init/update/final that skips
+ * the context buffering, most of our messages are one or two blocks long.
+ *
  * Return: A pointer to digest, or NULL on failure
  */
 uint8_t *sha256(int8_t const *s, size_t len,
 	uint8_t digest[SHA256_DIGEST_LENGTH])
 {
-	if (!digest)
+	uint32_t state[8];
+	uint8_t tail[2 * SHA256_CBLOCK];
+	size_t nb_full = len / SHA256_CBLOCK, nb;
+	int i;
+
+	if (!digest || (!s && len))
 		return (NULL);
 
-	SHA256((const unsigned char *)s, len, digest);
+	memcpy(state, sha256_iv, sizeof(state));
+	if (nb_full)
+		sha256_compress(state, (uint8_t const *)s, nb_full);
+	nb = sha256_pad_tail(tail, len);
+	if (len % SHA256_CBLOCK)
+		memcpy(tail, s + nb_full * SHA256_CBLOCK, len % SHA256_CBLOCK);
+	sha256_compress(state, tail, nb);
+	for (i = 0; i < 8; i++)
+		sha256_store_be32(digest + 4 * i, state[i]);
 	return (digest);
 }
@@ -0,0 +1,168 @@
+#include "sha256_internal.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_HAVE_LANES 1
+
+typedef uint32_t sha256_v4_t __attribute__((vector_size(16)));
+typedef uint32_t sha256_v8_t __attribute__((vector_size(32)));
+typedef uint32_t sha256_v16_t __attribute__((vector_size(64)));
+
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+#define SHA256_LANES 4
+#define SHA256_VEC_T sha256_v4_t
+#define SHA256_LANES_FN sha256_x4_sse41
+#define SHA256_TMPL_FN sha256_tmpl_x4_sse41
+#include "sha256_lanes.h"
+#undef SHA256_LANES
+#undef SHA256_VEC_T
+#undef SHA256_LANES_FN
+#undef SHA256_TMPL_FN
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#define SHA256_LANES 8
+#define SHA256_VEC_T sha256_v8_t
+#define SHA256_LANES_FN sha256_x8_avx2
+#define SHA256_TMPL_FN sha256_tmpl_x8_avx2
+#include "sha256_lanes.h"
+#undef SHA256_LANES
+#undef SHA256_VEC_T
+#undef SHA256_LANES_FN
+#undef SHA256_TMPL_FN
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#define SHA256_LANES 16
+#define SHA256_VEC_T sha256_v16_t
+#define SHA256_LANES_FN sha256_x16_avx512
+#define SHA256_TMPL_FN sha256_tmpl_x16_avx512
+#include "sha256_lanes.h"
+#undef SHA256_LANES
+#undef SHA256_VEC_T
+#undef SHA256_LANES_FN
+#undef SHA256_TMPL_FN
+#pragma GCC pop_options
+#endif
+
+/**
+ * sha256_batch_lanes - Tells how many messages the batch kernel hashes
+ * together on this CPU
+ *
+ * Description: Callers with an open-ended stream of messages (e.g. mining)
+ * should hand sha256_batch() multiples of this count.
+ *
+ * Return: 16, 8 or 4 for the AVX-512, AVX2 and SSE4.1 kernels, 1 when only
+ * the scalar fallback is available
+ */
+unsigned int sha256_batch_lanes(void)
+{
+#ifdef SHA256_HAVE_LANES
+	if (__builtin_cpu_supports("avx512f"))
+		return (16);
+	if (__builtin_cpu_supports("avx2"))
+		return (8);
+	if (__builtin_cpu_supports("sse4.1"))
+		return (4);
+#endif
+	return (1);
+}
+
+/**
+ * sha256_batch - Computes the SHA-256 hashes of several messages of the
+ * same length
+ * @msgs: Messages to hash
+ * @len: Length in bytes of every message
+ * @count: Number of messages
+ * @digests: Buffers receiving the digests, one per message
+ *
+ * Description: Messages are hashed by groups of sha256_batch_lanes(), using
+ * the widest SIMD kernel supported by the CPU. Narrower kernels, then the
+ * scalar sha256(), take care of the remainder.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int sha256_batch(int8_t const *const *msgs, size_t len, size_t count,
+	uint8_t (*digests)[SHA256_DIGEST_LENGTH])
+{
+	size_t i = 0;
+
+	if (!msgs || !digests)
+		return (0);
+#ifdef SHA256_HAVE_LANES
+	unsigned int lanes = sha256_batch_lanes();
+
+	for (; lanes >= 16 && count - i >= 16; i += 16)
+		sha256_x16_avx512(msgs + i, len, digests + i);
+	for (; lanes >= 8 && count - i >= 8; i += 8)
+		sha256_x8_avx2(msgs + i, len, digests + i);
+	for (; lanes >= 4 && count - i >= 4; i += 4)
+		sha256_x4_sse41(msgs + i, len, digests + i);
+#endif
+	for (; i < count; i++)
+		if (!sha256(msgs[i], len, digests[i]))
+			return (0);
+	return (1);
+}
+
+/**
+ * sha256_tmpl_lanes - Tells how many patches sha256_tmpl_try_batch should
+ * be given at once for a template
+ * @t: Template initialized with sha256_tmpl_init
+ *
+ * Description: One SHA-NI stream outruns the 4-lane kernel but not the
+ * 8- and 16-lane ones, so SHA-NI hosts only use lanes with AVX2 or better.
+ *
+ * Return: Preferred number of patches, between 1 and SHA256_BATCH_MAX
+ */
+unsigned int sha256_tmpl_lanes(sha256_tmpl_t const *t)
+{
+	unsigned int lanes = sha256_batch_lanes();
+
+	if (t && t->shani && lanes < 8)
+		return (1);
+	return (lanes);
+}
+
+/**
+ * sha256_tmpl_try_batch - Tries several patches of a template
+ * @t: Template initialized with sha256_tmpl_init
+ * @patches: Patches to try
+ * @count: Number of patches, at most 32
+ * @zero_bits: Number of leading zero bits the digests must have
+ * @digests: Receives the digests of the patches that pass
+ *
+ * Description: Same contract as sha256_tmpl_try for every patch, using the
+ * SIMD kernels by groups of sha256_tmpl_lanes().
+ *
+ * Return: Bitmask of the patches whose first 32 bits satisfy @zero_bits
+ */
+uint32_t sha256_tmpl_try_batch(sha256_tmpl_t const *t,
+	uint64_t const *patches, unsigned int count, uint32_t zero_bits,
+	uint8_t (*digests)[SHA256_DIGEST_LENGTH])
+{
+	unsigned int i = 0;
+	uint32_t mask = 0;
+
+	if (!t || !patches || !digests || count > 32)
+		return (0);
+#ifdef SHA256_HAVE_LANES
+	unsigned int lanes = sha256_tmpl_lanes(t);
+
+	for (; lanes >= 16 && count - i >= 16; i += 16)
+		mask |= sha256_tmpl_x16_avx512(t, patches + i, zero_bits,
+					       digests + i) << i;
+	for (; lanes >= 8 && count - i >= 8; i += 8)
+		mask |= sha256_tmpl_x8_avx2(t, patches + i, zero_bits,
+					    digests + i) << i;
+	for (; lanes >= 4 && count - i >= 4; i += 4)
+		mask |= sha256_tmpl_x4_sse41(t, patches + i, zero_bits,
+					     digests + i) << i;
+#endif
+	for (; i < count; i++)
+		if (sha256_tmpl_try(t, patches[i], zero_bits, digests[i]))
+			mask |= 1U << i;
+	return (mask);
+}
@@ -0,0 +1,182 @@
+#include "sha256_internal.h"
+
+#ifdef SHA256_HAVE_SHANI
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+uint32_t const sha256_iv[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+uint32_t const sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+	0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+	0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+	0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+typedef void (*sha256_compress_t)(uint32_t *, uint8_t const *, size_t);
+
+/**
+ * sha256_compress_generic - Portable SHA-256 compression function
+ * @state: Chaining state to update
+ * @blocks: Message blocks
+ * @nb: Number of 64-byte blocks in @blocks
+ */
+static void sha256_compress_generic(uint32_t state[8], uint8_t const *blocks,
+	size_t nb)
+{
+	uint32_t w[16], a, b, c, d, e, f, g, h, t1, t2;
+	unsigned int i;
+
+	for (; nb; nb--, blocks += SHA256_CBLOCK)
+	{
+		for (i = 0; i < 16; i++)
+			w[i] = sha256_load_be32(blocks + 4 * i);
+		a = state[0], b = state[1], c = state[2], d = state[3];
+		e = state[4], f = state[5], g = state[6], h = state[7];
+		for (i = 0; i < 64; i++)
+		{
+			if (i >= 16)
+				w[i & 15] += SHA256_s1(w[(i - 2) & 15]) +
+					w[(i - 7) & 15] + SHA256_s0(w[(i - 15) & 15]);
+			t1 = h + SHA256_S1(e) + SHA256_CH(e, f, g) + sha256_k[i] +
+				w[i & 15];
+			t2 = SHA256_S0(a) + SHA256_MAJ(a, b, c);
+			h = g, g = f, f = e, e = d + t1;
+			d = c, c = b, b = a, a = t1 + t2;
+		}
+		state[0] += a, state[1] += b, state[2] += c, state[3] += d;
+		state[4] += e, state[5] += f, state[6] += g, state[7] += h;
+	}
+}
+
+#ifdef SHA256_HAVE_SHANI
+#pragma GCC push_options
+#pragma GCC target("sha,sse4.1")
+
+/**
+ * sha256_compress_shani - SHA-256 compression using the SHA extensions
+ * @state: Chaining state to update
+ * @blocks: Message blocks
+ * @nb: Number of 64-byte blocks in @blocks
+ *
+ * Description: The state lives in two registers as ABEF and CDGH, each
+ * sha256rnds2 performs two rounds and the message schedule runs four
+ * rounds ahead through sha256msg1/sha256msg2.
+ */
+static void sha256_compress_shani(uint32_t state[8], uint8_t const *blocks,
+	size_t nb)
+{
+	__m128i abef, cdgh, abef_save, cdgh_save, msg[4], wk, tmp;
+	__m128i const bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+					     0x0405060700010203ULL);
+	unsigned int i;
+
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const *)state), 0xB1);
+	cdgh = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const *)(state + 4)),
+				 0x1B);
+	abef = _mm_alignr_epi8(tmp, cdgh, 8);
+	cdgh = _mm_blend_epi16(cdgh, tmp, 0xF0);
+	for (; nb; nb--, blocks += SHA256_CBLOCK)
+	{
+		abef_save = abef, cdgh_save = cdgh;
+		for (i = 0; i < 16; i++)
+		{
+			if (i < 4)
+				msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(
+					(__m128i const *)(blocks + 16 * i)), bswap);
+			wk = _mm_add_epi32(msg[i & 3], _mm_loadu_si128(
+				(__m128i const *)(sha256_k + 4 * i)));
+			cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+			if (i >= 3 && i <= 14)
+			{
+				tmp = _mm_alignr_epi8(msg[i & 3], msg[(i - 1) & 3], 4);
+				msg[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(
+					msg[(i + 1) & 3], tmp), msg[i & 3]);
+			}
+			abef = _mm_sha256rnds2_epu32(abef, cdgh,
+						     _mm_shuffle_epi32(wk, 0x0E));
+			if (i >= 1 && i <= 12)
+				msg[(i - 1) & 3] = _mm_sha256msg1_epu32(msg[(i - 1) & 3],
+									msg[i & 3]);
+		}
+		abef = _mm_add_epi32(abef, abef_save);
+		cdgh = _mm_add_epi32(cdgh, cdgh_save);
+	}
+	tmp = _mm_shuffle_epi32(abef, 0x1B);
+	cdgh = _mm_shuffle_epi32(cdgh, 0xB1);
+	_mm_storeu_si128((__m128i *)state, _mm_blend_epi16(tmp, cdgh, 0xF0));
+	_mm_storeu_si128((__m128i *)(state + 4), _mm_alignr_epi8(cdgh, tmp, 8));
+}
+
+#pragma GCC pop_options
+#endif
+
+/**
+ * sha256_cpu_has_shani - Tells whether the CPU has the SHA extensions
+ *
+ * Return: 1 if SHA-NI and SSE4.1 are available, 0 otherwise
+ */
+int sha256_cpu_has_shani(void)
+{
+#ifdef SHA256_HAVE_SHANI
+	unsigned int eax, ebx, ecx, edx;
+
+	/* SHA: CPUID.(EAX=7,ECX=0):EBX[29], SSE4.1: CPUID.1:ECX[19] */
+	if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+	    (ebx & (1U << 29)) &&
+	    __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1U << 19)))
+		return (1);
+#endif
+	return (0);
+}
+
+static void sha256_compress_resolve(uint32_t state[8], uint8_t const *blocks,
+	size_t nb);
+
+static sha256_compress_t sha256_compress_impl = sha256_compress_resolve;
+
+/**
+ * sha256_compress_resolve - Picks the compression function for this CPU
+ * @state: Chaining state to update
+ * @blocks: Message blocks
+ * @nb: Number of 64-byte blocks in @blocks
+ *
+ * Description: Installed as the initial implementation, it queries CPUID
+ * once, replaces itself with the best implementation and forwards the
+ * call. Concurrent first calls all store the same pointer.
+ */
+static void sha256_compress_resolve(uint32_t state[8], uint8_t const *blocks,
+	size_t nb)
+{
+	sha256_compress_t impl = sha256_compress_generic;
+
+#ifdef SHA256_HAVE_SHANI
+	if (sha256_cpu_has_shani())
+		impl = sha256_compress_shani;
+#endif
+	__atomic_store_n(&sha256_compress_impl, impl, __ATOMIC_RELAXED);
+	impl(state, blocks, nb);
+}
+
+/**
+ * sha256_compress - Runs the SHA-256 compression function over whole blocks
+ * @state: Chaining state to update
+ * @blocks: Message blocks
+ * @nb: Number of 64-byte blocks in @blocks
+ */
+void sha256_compress(uint32_t state[8], uint8_t const *blocks, size_t nb)
+{
+	__atomic_load_n(&sha256_compress_impl, __ATOMIC_RELAXED)(state, blocks,
+								  nb);
+}
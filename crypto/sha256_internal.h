@@ -0,0 +1,96 @@
+#ifndef SHA256_INTERNAL_H
+#define SHA256_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "hblk_crypto.h"
+
+/* Private to the crypto library: shared by the SHA-256 implementations */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_HAVE_SHANI 1
+#endif
+
+extern uint32_t const sha256_iv[8];
+extern uint32_t const sha256_k[64];
+
+/* Work on scalars as well as on GCC vectors, one message per lane */
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define SHA256_S0(x) (SHA256_ROTR(x, 2) ^ SHA256_ROTR(x, 13) ^ \
+	SHA256_ROTR(x, 22))
+#define SHA256_S1(x) (SHA256_ROTR(x, 6) ^ SHA256_ROTR(x, 11) ^ \
+	SHA256_ROTR(x, 25))
+#define SHA256_s0(x) (SHA256_ROTR(x, 7) ^ SHA256_ROTR(x, 18) ^ ((x) >> 3))
+#define SHA256_s1(x) (SHA256_ROTR(x, 17) ^ SHA256_ROTR(x, 19) ^ ((x) >> 10))
+#define SHA256_CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define SHA256_MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+
+void sha256_compress(uint32_t state[8], uint8_t const *blocks, size_t nb);
+int sha256_cpu_has_shani(void);
+void sha256_schedule(uint8_t const *block, uint32_t wk[64]);
+void sha256_rounds(uint32_t v[8], uint32_t const wk[64],
+	unsigned int first, unsigned int last);
+
+/**
+ * sha256_load_be32 - Reads a big-endian 32-bit word
+ * @p: Pointer to the 4 bytes to read
+ *
+ * Return: The word in host order
+ */
+static inline uint32_t sha256_load_be32(uint8_t const *p)
+{
+	return ((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+		(uint32_t)p[2] << 8 | (uint32_t)p[3]);
+}
+
+/**
+ * sha256_store_be32 - Writes a 32-bit word in big-endian order
+ * @p: Pointer to the 4 bytes to write
+ * @x: Word to write
+ */
+static inline void sha256_store_be32(uint8_t *p, uint32_t x)
+{
+	p[0] = x >> 24, p[1] = x >> 16, p[2] = x >> 8, p[3] = x;
+}
+
+/**
+ * sha256_pad_tail - Prepares the padding blocks of a message
+ * @tail: Buffer of two SHA-256 blocks
+ * @len: Length of the whole message
+ *
+ * Description: The trailing len % 64 message bytes are left zeroed, the
+ * caller copies them in front of the 0x80 marker.
+ *
+ * Return: Number of blocks of @tail to compress, 1 or 2
+ */
+static inline size_t sha256_pad_tail(uint8_t tail[2 * SHA256_CBLOCK],
+	size_t len)
+{
+	size_t rem = len % SHA256_CBLOCK, nb = rem + 9 > SHA256_CBLOCK ? 2 : 1;
+	uint64_t bits = (uint64_t)len << 3;
+
+	memset(tail, 0, 2 * SHA256_CBLOCK);
+	tail[rem] = 0x80;
+	sha256_store_be32(tail + nb * SHA256_CBLOCK - 8, bits >> 32);
+	sha256_store_be32(tail + nb * SHA256_CBLOCK - 4, (uint32_t)bits);
+	return (nb);
+}
+
+/**
+ * sha256_lead_ok - Checks the leading bits of the first digest word
+ * @h0: First word of the digest
+ * @zero_bits: Number of leading zero bits required, at most 32 are checked
+ *
+ * Return: 1 if the leading bits are zero, 0 otherwise
+ */
+static inline int sha256_lead_ok(uint32_t h0, uint32_t zero_bits)
+{
+	if (!zero_bits)
+		return (1);
+	if (zero_bits >= 32)
+		return (h0 == 0);
+	return ((h0 >> (32 - zero_bits)) == 0);
+}
+
+#endif /* SHA256_INTERNAL_H */
@@ -0,0 +1,148 @@
+/*
+ * Multi-buffer SHA-256 kernel template, included by sha256_batch.c once per
+ * lane width. Before including it, define:
+ *
+ *   SHA256_LANES     Number of messages hashed together
+ *   SHA256_VEC_T     Vector type holding SHA256_LANES uint32_t
+ *   SHA256_LANES_FN  Name of the generated batch hashing function
+ *   SHA256_TMPL_FN   Name of the generated template (mining) function
+ *
+ * Each message occupies one lane of every vector, so the 64 rounds run once
+ * for all of them. No include guard on purpose.
+ */
+
+/**
+ * SHA256_LANES_FN - Hashes SHA256_LANES messages of the same length at once
+ * @msgs: Messages to hash
+ * @len: Length in bytes of every message
+ * @digests: Buffers receiving the digests, one per message
+ */
+static void SHA256_LANES_FN(int8_t const *const *msgs, size_t len,
+	uint8_t (*digests)[SHA256_DIGEST_LENGTH])
+{
+	uint8_t tail[SHA256_LANES][2 * SHA256_CBLOCK];
+	uint8_t const *blocks[SHA256_LANES];
+	SHA256_VEC_T st[8], w[16], a, b, c, d, e, f, g, h, t1, t2;
+	size_t nb_full = len / SHA256_CBLOCK, nb_blocks, blk;
+	unsigned int i, l;
+
+	nb_blocks = nb_full + sha256_pad_tail(tail[0], len);
+	for (l = 1; l < SHA256_LANES; l++)
+		memcpy(tail[l], tail[0], sizeof(tail[l]));
+	for (l = 0; l < SHA256_LANES; l++)
+		memcpy(tail[l], msgs[l] + nb_full * SHA256_CBLOCK,
+		       len % SHA256_CBLOCK);
+	for (i = 0; i < 8; i++)
+		st[i] = (SHA256_VEC_T){0} + sha256_iv[i];
+	for (blk = 0; blk < nb_blocks; blk++)
+	{
+		for (l = 0; l < SHA256_LANES; l++)
+			blocks[l] = blk < nb_full ?
+				(uint8_t const *)msgs[l] + blk * SHA256_CBLOCK :
+				tail[l] + (blk - nb_full) * SHA256_CBLOCK;
+		for (i = 0; i < 16; i++)
+			for (l = 0; l < SHA256_LANES; l++)
+				w[i][l] = sha256_load_be32(blocks[l] + 4 * i);
+		a = st[0], b = st[1], c = st[2], d = st[3];
+		e = st[4], f = st[5], g = st[6], h = st[7];
+		for (i = 0; i < 64; i++)
+		{
+			if (i >= 16)
+				w[i & 15] += SHA256_s1(w[(i - 2) & 15]) +
+					w[(i - 7) & 15] + SHA256_s0(w[(i - 15) & 15]);
+			t1 = h + SHA256_S1(e) + SHA256_CH(e, f, g) + sha256_k[i] +
+				w[i & 15];
+			t2 = SHA256_S0(a) + SHA256_MAJ(a, b, c);
+			h = g, g = f, f = e, e = d + t1;
+			d = c, c = b, b = a, a = t1 + t2;
+		}
+		st[0] += a, st[1] += b, st[2] += c, st[3] += d;
+		st[4] += e, st[5] += f, st[6] += g, st[7] += h;
+	}
+	for (l = 0; l < SHA256_LANES; l++)
+		for (i = 0; i < 8; i++)
+			sha256_store_be32(digests[l] + 4 * i, st[i][l]);
+}
+
+/**
+ * SHA256_TMPL_FN - Tries SHA256_LANES patches of a template at once
+ * @t: Template initialized with sha256_tmpl_init
+ * @patches: One 8-byte patch per lane
+ * @zero_bits: Number of leading zero bits the digests must have
+ * @digests: Receives the digests of the lanes that pass
+ *
+ * Description: Vector version of sha256_tmpl_try: the rounds preceding the
+ * patch are skipped, the trailing schedules are shared by every lane, and
+ * the digests are only finalized when a lane passes on its first word.
+ *
+ * Return: Bitmask of the lanes whose first 32 bits satisfy @zero_bits
+ */
+static uint32_t SHA256_TMPL_FN(sha256_tmpl_t const *t,
+	uint64_t const *patches, uint32_t zero_bits,
+	uint8_t (*digests)[SHA256_DIGEST_LENGTH])
+{
+	uint8_t blk[SHA256_LANES][SHA256_CBLOCK];
+	SHA256_VEC_T hs[8], w[16], a, b, c, d, e, f, g, h, t1, t2;
+	unsigned int i, l, first = t->patch_off / 4, last = (t->patch_off + 7) / 4;
+	uint32_t mask = 0;
+	size_t blkn;
+
+	for (l = 0; l < SHA256_LANES; l++)
+	{
+		memcpy(blk[l], t->block, SHA256_CBLOCK);
+		memcpy(blk[l] + t->patch_off, &patches[l], sizeof(patches[l]));
+	}
+	for (i = 0; i < 16; i++)
+		if (i < first || i > last)
+			w[i] = (SHA256_VEC_T){0} + sha256_load_be32(t->block + 4 * i);
+		else
+			for (l = 0; l < SHA256_LANES; l++)
+				w[i][l] = sha256_load_be32(blk[l] + 4 * i);
+	a = (SHA256_VEC_T){0} + t->part[0], b = (SHA256_VEC_T){0} + t->part[1];
+	c = (SHA256_VEC_T){0} + t->part[2], d = (SHA256_VEC_T){0} + t->part[3];
+	e = (SHA256_VEC_T){0} + t->part[4], f = (SHA256_VEC_T){0} + t->part[5];
+	g = (SHA256_VEC_T){0} + t->part[6], h = (SHA256_VEC_T){0} + t->part[7];
+	for (i = 0; i < 64; i++)
+	{
+		if (i >= 16)
+			w[i & 15] += SHA256_s1(w[(i - 2) & 15]) +
+				w[(i - 7) & 15] + SHA256_s0(w[(i - 15) & 15]);
+		if (i < t->skip)
+			continue;
+		t1 = h + SHA256_S1(e) + SHA256_CH(e, f, g) + sha256_k[i] +
+			w[i & 15];
+		t2 = SHA256_S0(a) + SHA256_MAJ(a, b, c);
+		h = g, g = f, f = e, e = d + t1;
+		d = c, c = b, b = a, a = t1 + t2;
+	}
+	for (i = 0; i < 8; i++)
+		hs[i] = (SHA256_VEC_T){0} + t->mid[i];
+	for (blkn = 0; blkn < t->nb_trailing; blkn++)
+	{
+		hs[0] += a, hs[1] += b, hs[2] += c, hs[3] += d;
+		hs[4] += e, hs[5] += f, hs[6] += g, hs[7] += h;
+		a = hs[0], b = hs[1], c = hs[2], d = hs[3];
+		e = hs[4], f = hs[5], g = hs[6], h = hs[7];
+		for (i = 0; i < 64; i++)
+		{
+			t1 = h + SHA256_S1(e) + SHA256_CH(e, f, g) +
+				t->wk[64 * blkn + i];
+			t2 = SHA256_S0(a) + SHA256_MAJ(a, b, c);
+			h = g, g = f, f = e, e = d + t1;
+			d = c, c = b, b = a, a = t1 + t2;
+		}
+	}
+	hs[0] += a;
+	for (l = 0; l < SHA256_LANES; l++)
+		if (sha256_lead_ok(hs[0][l], zero_bits))
+			mask |= 1U << l;
+	if (!mask)
+		return (0);
+	hs[1] += b, hs[2] += c, hs[3] += d;
+	hs[4] += e, hs[5] += f, hs[6] += g, hs[7] += h;
+	for (l = 0; l < SHA256_LANES; l++)
+		if (mask & (1U << l))
+			for (i = 0; i < 8; i++)
+				sha256_store_be32(digests[l] + 4 * i, hs[i][l]);
+	return (mask);
+}
@@ -0,0 +1,113 @@
+#include "sha256_internal.h"
+#include <stdlib.h>
+
+/**
+ * sha256_rounds - Runs a range of SHA-256 rounds with a ready schedule
+ * @v: Working variables a..h, updated in place
+ * @wk: Message schedule with the round constants added, w[i] + k[i]
+ * @first: First round to run
+ * @last: One past the last round to run
+ *
+ * Description: The chaining addition is left to the caller.
+ */
+void sha256_rounds(uint32_t v[8], uint32_t const wk[64],
+	unsigned int first, unsigned int last)
+{
+	uint32_t a = v[0], b = v[1], c = v[2], d = v[3];
+	uint32_t e = v[4], f = v[5], g = v[6], h = v[7], t1, t2;
+	unsigned int i;
+
+	for (i = first; i < last; i++)
+	{
+		t1 = h + SHA256_S1(e) + SHA256_CH(e, f, g) + wk[i];
+		t2 = SHA256_S0(a) + SHA256_MAJ(a, b, c);
+		h = g, g = f, f = e, e = d + t1;
+		d = c, c = b, b = a, a = t1 + t2;
+	}
+	v[0] = a, v[1] = b, v[2] = c, v[3] = d;
+	v[4] = e, v[5] = f, v[6] = g, v[7] = h;
+}
+
+/**
+ * sha256_schedule - Expands a block into its message schedule, round
+ * constants included
+ * @block: 64-byte message block
+ * @wk: Receives w[i] + k[i] for the 64 rounds
+ */
+void sha256_schedule(uint8_t const *block, uint32_t wk[64])
+{
+	uint32_t w[64];
+	unsigned int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = sha256_load_be32(block + 4 * i);
+	for (; i < 64; i++)
+		w[i] = SHA256_s1(w[i - 2]) + w[i - 7] + SHA256_s0(w[i - 15]) +
+			w[i - 16];
+	for (i = 0; i < 64; i++)
+		wk[i] = w[i] + sha256_k[i];
+}
+
+/**
+ * sha256_tmpl_init - Prepares the hashing of a message in which only 8
+ * bytes change from one attempt to the next
+ * @t: Template to initialize
+ * @msg: Message, the bytes at @patch_off are ignored
+ * @len: Length of @msg
+ * @patch_off: Offset of the 8 variable bytes, they must not straddle a
+ *             64-byte block boundary
+ *
+ * Description: Everything that does not depend on the patch is carried
+ * forward: the chaining state before the patched block, the state after
+ * the rounds of that block that precede the patch (rounded down to a
+ * multiple of four), and the complete schedules of the blocks after it,
+ * padding included.
+ *
+ * Return: 1 on success, 0 on failure
+ */
+int sha256_tmpl_init(sha256_tmpl_t *t, void const *msg, size_t len,
+	size_t patch_off)
+{
+	uint8_t *padded, tail[2 * SHA256_CBLOCK];
+	size_t nb_blocks, pb = patch_off / SHA256_CBLOCK, i;
+	uint32_t wk[64];
+
+	if (!t || !msg || patch_off + 8 > len ||
+	    patch_off % SHA256_CBLOCK + 8 > SHA256_CBLOCK)
+		return (0);
+	nb_blocks = len / SHA256_CBLOCK + sha256_pad_tail(tail, len);
+	padded = malloc(nb_blocks * SHA256_CBLOCK);
+	t->nb_trailing = nb_blocks - pb - 1;
+	t->wk = malloc((t->nb_trailing + 1) * sizeof(wk));
+	if (!padded || !t->wk)
+		return (free(padded), free(t->wk), t->wk = NULL, 0);
+	memcpy(padded + len - len % SHA256_CBLOCK, tail,
+	       nb_blocks * SHA256_CBLOCK - (len - len % SHA256_CBLOCK));
+	memcpy(padded, msg, len);
+	memcpy(t->mid, sha256_iv, sizeof(t->mid));
+	sha256_compress(t->mid, padded, pb);
+	memcpy(t->block, padded + pb * SHA256_CBLOCK, SHA256_CBLOCK);
+	t->patch_off = patch_off % SHA256_CBLOCK;
+	t->skip = (t->patch_off / 4) & ~3U;
+	memcpy(t->part, t->mid, sizeof(t->part));
+	sha256_schedule(t->block, wk);
+	sha256_rounds(t->part, wk, 0, t->skip);
+	for (i = 0; i < t->nb_trailing; i++)
+		sha256_schedule(padded + (pb + 1 + i) * SHA256_CBLOCK,
+				t->wk + 64 * i);
+	t->shani = sha256_cpu_has_shani();
+	free(padded);
+	return (1);
+}
+
+/**
+ * sha256_tmpl_destroy - Releases the resources held by a template
+ * @t: Template initialized with sha256_tmpl_init
+ */
+void sha256_tmpl_destroy(sha256_tmpl_t *t)
+{
+	if (!t)
+		return;
+	free(t->wk);
+	t->wk = NULL;
+}
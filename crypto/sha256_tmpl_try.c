@@ -0,0 +1,153 @@
+#include "sha256_internal.h"
+
+#ifdef SHA256_HAVE_SHANI
+#include <immintrin.h>
+#endif
+
+/**
+ * sha256_tmpl_try_generic - Portable version of sha256_tmpl_try
+ * @t: Template
+ * @block: Patched copy of the template's block
+ * @zero_bits: Number of leading zero bits required
+ * @h: Receives the final chaining state when the first word passes
+ *
+ * Return: 1 if the first digest word passes, 0 otherwise
+ */
+static int sha256_tmpl_try_generic(sha256_tmpl_t const *t,
+	uint8_t const *block, uint32_t zero_bits, uint32_t h[8])
+{
+	uint32_t v[8], wk[64];
+	size_t b;
+	int i;
+
+	memcpy(v, t->part, sizeof(v));
+	sha256_schedule(block, wk);
+	sha256_rounds(v, wk, t->skip, 64);
+	for (b = 0; ; b++)
+	{
+		h[0] = (b ? h[0] : t->mid[0]) + v[0];
+		if (b == t->nb_trailing && !sha256_lead_ok(h[0], zero_bits))
+			return (0);
+		for (i = 1; i < 8; i++)
+			h[i] = (b ? h[i] : t->mid[i]) + v[i];
+		if (b == t->nb_trailing)
+			return (1);
+		memcpy(v, h, sizeof(v));
+		sha256_rounds(v, t->wk + 64 * b, 0, 64);
+	}
+}
+
+#ifdef SHA256_HAVE_SHANI
+#pragma GCC push_options
+#pragma GCC target("sha,sse4.1")
+
+/**
+ * sha256_tmpl_try_shani - SHA-NI version of sha256_tmpl_try
+ * @t: Template
+ * @block: Patched copy of the template's block
+ * @zero_bits: Number of leading zero bits required
+ * @h: Receives the final chaining state when the first word passes
+ *
+ * Description: The rounds of the patched block that precede the patch are
+ * skipped, its schedule is still derived for all of them. Trailing blocks
+ * only run sha256rnds2 over their precomputed schedules.
+ *
+ * Return: 1 if the first digest word passes, 0 otherwise
+ */
+static int sha256_tmpl_try_shani(sha256_tmpl_t const *t,
+	uint8_t const *block, uint32_t zero_bits, uint32_t h[8])
+{
+	__m128i abef, cdgh, habef, hcdgh, msg[4], wk, tmp;
+	__m128i const bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+					     0x0405060700010203ULL);
+	unsigned int i;
+	size_t b;
+
+	abef = _mm_set_epi32(t->part[0], t->part[1], t->part[4], t->part[5]);
+	cdgh = _mm_set_epi32(t->part[2], t->part[3], t->part[6], t->part[7]);
+	for (i = 0; i < 16; i++)
+	{
+		if (i < 4)
+			msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(
+				(__m128i const *)(block + 16 * i)), bswap);
+		wk = _mm_add_epi32(msg[i & 3], _mm_loadu_si128(
+			(__m128i const *)(sha256_k + 4 * i)));
+		if (4 * i >= t->skip)
+			cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+		if (i >= 3 && i <= 14)
+		{
+			tmp = _mm_alignr_epi8(msg[i & 3], msg[(i - 1) & 3], 4);
+			msg[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(
+				msg[(i + 1) & 3], tmp), msg[i & 3]);
+		}
+		if (4 * i >= t->skip)
+			abef = _mm_sha256rnds2_epu32(abef, cdgh,
+						     _mm_shuffle_epi32(wk, 0x0E));
+		if (i >= 1 && i <= 12)
+			msg[(i - 1) & 3] = _mm_sha256msg1_epu32(msg[(i - 1) & 3],
+								msg[i & 3]);
+	}
+	habef = _mm_set_epi32(t->mid[0], t->mid[1], t->mid[4], t->mid[5]);
+	hcdgh = _mm_set_epi32(t->mid[2], t->mid[3], t->mid[6], t->mid[7]);
+	for (b = 0; b < t->nb_trailing; b++)
+	{
+		habef = abef = _mm_add_epi32(abef, habef);
+		hcdgh = cdgh = _mm_add_epi32(cdgh, hcdgh);
+		for (i = 0; i < 16; i++)
+		{
+			wk = _mm_loadu_si128((__m128i const *)(t->wk + 64 * b + 4 * i));
+			cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+			abef = _mm_sha256rnds2_epu32(abef, cdgh,
+						     _mm_shuffle_epi32(wk, 0x0E));
+		}
+	}
+	abef = _mm_add_epi32(abef, habef);
+	h[0] = _mm_extract_epi32(abef, 3);
+	if (!sha256_lead_ok(h[0], zero_bits))
+		return (0);
+	cdgh = _mm_add_epi32(cdgh, hcdgh);
+	h[1] = _mm_extract_epi32(abef, 2), h[4] = _mm_extract_epi32(abef, 1);
+	h[5] = _mm_extract_epi32(abef, 0), h[2] = _mm_extract_epi32(cdgh, 3);
+	h[3] = _mm_extract_epi32(cdgh, 2), h[6] = _mm_extract_epi32(cdgh, 1);
+	h[7] = _mm_extract_epi32(cdgh, 0);
+	return (1);
+}
+
+#pragma GCC pop_options
+#endif
+
+/**
+ * sha256_tmpl_try - Hashes a template with a given patch, rejecting early
+ * @t: Template initialized with sha256_tmpl_init
+ * @patch: 8 bytes stored at the template's patch offset, in host order
+ * @zero_bits: Number of leading zero bits the digest must have
+ * @digest: Receives the digest when it is not rejected
+ *
+ * Description: The first word of the digest is checked before the others
+ * are finalized. Only up to 32 leading bits can be checked that way, for
+ * larger @zero_bits the caller must check the rest of @digest.
+ *
+ * Return: 1 if the first 32 bits of the digest satisfy @zero_bits and
+ * @digest was written, 0 otherwise
+ */
+int sha256_tmpl_try(sha256_tmpl_t const *t, uint64_t patch,
+	uint32_t zero_bits, uint8_t digest[SHA256_DIGEST_LENGTH])
+{
+	uint8_t block[SHA256_CBLOCK];
+	uint32_t h[8];
+	int i, ok;
+
+	memcpy(block, t->block, SHA256_CBLOCK);
+	memcpy(block + t->patch_off, &patch, sizeof(patch));
+#ifdef SHA256_HAVE_SHANI
+	if (t->shani)
+		ok = sha256_tmpl_try_shani(t, block, zero_bits, h);
+	else
+#endif
+		ok = sha256_tmpl_try_generic(t, block, zero_bits, h);
+	if (!ok)
+		return (0);
+	for (i = 0; i < 8; i++)
+		sha256_store_be32(digest + 4 * i, h[i]);
+	return (1);
+}